@@ -0,0 +1,49 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <vivid/binding.h>
+
+#define BENCHMARK_NUM_EVENTS 100000U
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Processes triggered events until none remain, without any system calls, and returns the number
+// of event callbacks made:
+size_t benchmark_run(vivid_binding_t *binding);
+
+void benchmark_burst(vivid_binding_t *binding);
+
+// Only built where pthreads are available:
+void benchmark_contention(vivid_binding_t *binding);
+
+void benchmark_dispatcher(vivid_binding_t *binding);
+
+// The link state machine of dispatcher.c, written with the C++ front-end, see frontend.cpp:
+void *benchmark_frontend_create(vivid_binding_t *binding);
+
+void benchmark_frontend_destroy(void *link);
+
+void benchmark_frontend_event(void *link, unsigned event);
+
+// Returns the active leaf state, 0 for closed, 1 for streaming and 2 for paused:
+unsigned benchmark_frontend_get(void *link, unsigned *trace, unsigned *count);
+
+void benchmark_instances(vivid_binding_t *binding);
+
+void benchmark_jumps(vivid_binding_t *binding);
+
+void benchmark_parallel(vivid_binding_t *binding);
+
+void benchmark_payload(vivid_binding_t *binding);
+
+void benchmark_pipeline(vivid_binding_t *binding);
+
+void benchmark_transitions(vivid_binding_t *binding);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
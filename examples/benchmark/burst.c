@@ -0,0 +1,234 @@
+#include "benchmark.h"
+#include <stdio.h>
+#include <string.h>
+#include <vivid/sm.h>
+
+// Queues bursts of events and handles them with different event budgets, then queues bursts of a
+// coalesced event, and a burst followed by a priority event. Each callback stands for a wakeup of
+// the binding, i.e. a system call on most real bindings. Last, queues bursts into a small queue,
+// without and with a pool of segments to grow into, then with each overload policy that does not
+// block, as there is no other thread to handle the events meanwhile. Finally, with VIVID_PARAM,
+// queues bursts of updates that take a while to handle, without and with a time to live.
+
+#define BURST_SIZE 64U
+#define SMALL_QUEUE_SIZE 8U
+#define SEGMENT_SIZE 16U
+#define NUM_UPDATE_BURSTS 100U
+#define UPDATE_TIME 10e-6 // Time taken to handle an update
+#define UPDATE_TTL 100e-6
+
+typedef struct {
+    vivid_sm_t *vsm;
+    unsigned count;
+    unsigned num_polls;
+    unsigned cancel_count;
+    unsigned num_watermarks;
+    vivid_binding_t *binding;
+    unsigned num_updates;
+} burst_t;
+
+VIVID_EVENT_PUBLIC(burst_t, burst, ev_tick, vsm);
+VIVID_EVENT_COALESCED_PUBLIC(burst_t, burst, ev_poll, vsm);
+VIVID_EVENT_PRIORITY_PUBLIC(burst_t, burst, ev_cancel, 1U, vsm);
+#if VIVID_PARAM
+VIVID_EVENT_PARAM_PUBLIC(burst_t, burst, ev_update, unsigned, vsm);
+VIVID_EVENT_PARAM_TTL_PUBLIC(burst_t, burst, ev_fresh_update, unsigned, UPDATE_TTL, vsm);
+
+static void update(burst_t *me)
+{
+    me->num_updates++;
+    vivid_time_t end_time = me->binding->get_time(me->binding) + UPDATE_TIME;
+    while (me->binding->get_time(me->binding) < end_time) {
+    }
+}
+#endif
+
+VIVID_DECLARE_STATE(root);
+
+VIVID_STATE(burst_t, root)
+{
+    VIVID_ON_EVENT(ev_tick, true, NULL, me->count++;);
+    VIVID_ON_EVENT(ev_poll, true, NULL, me->num_polls++;);
+    VIVID_ON_EVENT(ev_cancel, true, NULL, me->cancel_count = me->count;);
+#if VIVID_PARAM
+    VIVID_ON_EVENT_PARAM(ev_update, true, NULL, update(me););
+    VIVID_ON_EVENT_PARAM(ev_fresh_update, true, NULL, update(me););
+#endif
+}
+
+// Returns false if the run could not be completed:
+static bool run_small_queue(vivid_binding_t *binding, vivid_queue_pool_t *pool, size_t max_bytes)
+{
+    burst_t me = { 0 };
+    me.vsm = VIVID_CREATE_SM(binding, "burst", root, SMALL_QUEUE_SIZE, &me);
+    if (me.vsm == NULL) {
+        printf("burst | could not create state machine\n");
+        return false;
+    }
+    if ((pool != NULL) && !vivid_set_queue_pool(me.vsm, pool, max_bytes)) {
+        printf("burst | could not set queue pool\n");
+        vivid_destroy_sm(me.vsm);
+        return false;
+    }
+    vivid_set_event_budget(me.vsm, 0U, 0);
+    benchmark_run(binding);
+    unsigned num_bursts = BENCHMARK_NUM_EVENTS / BURST_SIZE;
+    vivid_time_t start = binding->get_time(binding);
+    for (unsigned j = 0U; j < num_bursts; j++) {
+        for (unsigned k = 0U; k < BURST_SIZE; k++) {
+            burst_ev_tick(&me);
+        }
+        benchmark_run(binding);
+    }
+    double time = (binding->get_time(binding) - start) * 1e9 / (num_bursts * BURST_SIZE);
+    printf("burst | %-10s | %9zu | %10.1f | %17.1f | %8zu\n", (pool == NULL) ? "fixed" : "growable", max_bytes, time, (double)me.count / num_bursts,
+        (pool == NULL) ? 0U : vivid_queue_get_pool_bytes(pool));
+    vivid_destroy_sm(me.vsm);
+    return true;
+}
+
+static void count_watermark(void *app, bool high)
+{
+    (void)high;
+    ((burst_t *)app)->num_watermarks++;
+}
+
+static void run_overload(vivid_binding_t *binding, vivid_overload_policy_t policy, const char *policy_name)
+{
+    burst_t me = { 0 };
+    me.vsm = VIVID_CREATE_SM(binding, "burst", root, SMALL_QUEUE_SIZE, &me);
+    if (me.vsm == NULL) {
+        printf("burst | could not create state machine\n");
+        return;
+    }
+    if (!vivid_set_overload_policy(me.vsm, policy, 0)) {
+        printf("burst | %-13s | not available\n", policy_name);
+        vivid_destroy_sm(me.vsm);
+        return;
+    }
+    vivid_set_watermarks(me.vsm, SMALL_QUEUE_SIZE - 1U, 1U, count_watermark);
+    vivid_set_event_budget(me.vsm, 0U, 0);
+    benchmark_run(binding);
+    unsigned num_bursts = BENCHMARK_NUM_EVENTS / BURST_SIZE;
+    vivid_time_t start = binding->get_time(binding);
+    for (unsigned j = 0U; j < num_bursts; j++) {
+        for (unsigned k = 0U; k < BURST_SIZE; k++) {
+            burst_ev_tick(&me);
+        }
+        benchmark_run(binding);
+    }
+    double time = (binding->get_time(binding) - start) * 1e9 / (num_bursts * BURST_SIZE);
+    printf("burst | %-13s | %10.1f | %17.1f | %17.1f | %10.1f\n", policy_name, time, (double)me.count / num_bursts,
+        (double)vivid_get_num_dropped_events(me.vsm) / num_bursts, (double)me.num_watermarks / num_bursts);
+    vivid_destroy_sm(me.vsm);
+}
+
+#if VIVID_PARAM
+static void run_updates(vivid_binding_t *binding, bool ttl)
+{
+    burst_t me = { 0 };
+    me.binding = binding;
+    me.vsm = VIVID_CREATE_SM(binding, "burst", root, BURST_SIZE, &me);
+    if (me.vsm == NULL) {
+        printf("burst | could not create state machine\n");
+        return;
+    }
+    vivid_set_event_budget(me.vsm, 0U, 0);
+    benchmark_run(binding);
+    vivid_time_t start = binding->get_time(binding);
+    for (unsigned j = 0U; j < NUM_UPDATE_BURSTS; j++) {
+        for (unsigned k = 0U; k < BURST_SIZE; k++) {
+            if (ttl) {
+                burst_ev_fresh_update(&me, &k);
+            } else {
+                burst_ev_update(&me, &k);
+            }
+        }
+        benchmark_run(binding);
+    }
+    double time = (binding->get_time(binding) - start) * 1e6 / NUM_UPDATE_BURSTS;
+    printf("burst | %3s | %10.1f | %17.1f | %17.1f\n", ttl ? "yes" : "no", time, (double)me.num_updates / NUM_UPDATE_BURSTS,
+        (double)VIVID_NUM_EXPIRED_EVENTS(me.vsm, ev_fresh_update) / NUM_UPDATE_BURSTS);
+    vivid_destroy_sm(me.vsm);
+}
+#endif
+
+void benchmark_burst(vivid_binding_t *binding)
+{
+    static const size_t budgets[] = { 1U, 4U, 16U, 0U };
+    burst_t me = { 0 };
+    me.vsm = VIVID_CREATE_SM_WITH_LANES(binding, "burst", root, BURST_SIZE, 2U, &me);
+    if (me.vsm == NULL) {
+        printf("burst | could not create state machine\n");
+        return;
+    }
+    benchmark_run(binding);
+    printf("burst | budget | event (ns) | callbacks per burst\n");
+    for (size_t i = 0U; i < (sizeof(budgets) / sizeof(budgets[0])); i++) {
+        vivid_set_event_budget(me.vsm, budgets[i], 0);
+        me.count = 0U;
+        size_t num_callbacks = 0U;
+        vivid_time_t start = binding->get_time(binding);
+        for (unsigned j = 0U; j < (BENCHMARK_NUM_EVENTS / BURST_SIZE); j++) {
+            for (unsigned k = 0U; k < BURST_SIZE; k++) {
+                burst_ev_tick(&me);
+            }
+            num_callbacks += benchmark_run(binding);
+        }
+        unsigned num_events = (BENCHMARK_NUM_EVENTS / BURST_SIZE) * BURST_SIZE;
+        double time = (binding->get_time(binding) - start) * 1e9 / num_events;
+        printf("burst | %6zu | %10.1f | %19.1f\n", budgets[i], time, (double)num_callbacks * BURST_SIZE / num_events);
+        if (me.count != num_events) {
+            printf("burst | unexpected count\n");
+        }
+    }
+    vivid_set_event_budget(me.vsm, 0U, 0);
+    unsigned num_bursts = BENCHMARK_NUM_EVENTS / BURST_SIZE;
+    vivid_time_t start = binding->get_time(binding);
+    for (unsigned j = 0U; j < num_bursts; j++) {
+        for (unsigned k = 0U; k < BURST_SIZE; k++) {
+            burst_ev_poll(&me);
+        }
+        benchmark_run(binding);
+    }
+    double time = (binding->get_time(binding) - start) * 1e9 / (num_bursts * BURST_SIZE);
+    printf("burst | coalesced event (ns) | handled per burst\n");
+    printf("burst | %20.1f | %17.1f\n", time, (double)me.num_polls / num_bursts);
+    me.count = 0U;
+    for (unsigned k = 0U; k < BURST_SIZE; k++) {
+        burst_ev_tick(&me);
+    }
+    burst_ev_cancel(&me);
+    benchmark_run(binding);
+    printf("burst | events handled before a priority event queued last: %u\n", me.cancel_count);
+    vivid_destroy_sm(me.vsm);
+
+    // The events beyond the queue and the limit of the state machine are lost:
+    vivid_binding_t quiet = *binding;
+#if VIVID_LOG
+    quiet.log = NULL;
+#endif
+    // The segments hold the largest param of the state machine, see vivid_get_max_param_size():
+    vivid_queue_pool_t *pool = vivid_queue_create_pool(&quiet, SEGMENT_SIZE, 0U VIVID_PARAM_STATIC_ARGS(, sizeof(unsigned)));
+    if (pool == NULL) {
+        printf("burst | could not create pool\n");
+        return;
+    }
+    printf("burst | queue      | limit (B) | event (ns) | handled per burst | pool (B)\n");
+    bool completed = run_small_queue(&quiet, NULL, 0U) && run_small_queue(&quiet, pool, 0U) && run_small_queue(&quiet, pool, vivid_queue_get_pool_bytes(pool) / 2U);
+    vivid_queue_destroy_pool(pool);
+    if (!completed) {
+        return;
+    }
+
+    printf("burst | policy        | event (ns) | handled per burst | dropped per burst | watermarks\n");
+    run_overload(&quiet, VIVID_OVERLOAD_REJECT_NEWEST, "reject newest");
+    run_overload(&quiet, VIVID_OVERLOAD_DROP_OLDEST, "drop oldest");
+    run_overload(&quiet, VIVID_OVERLOAD_REPLACE_SAME, "replace same");
+
+#if VIVID_PARAM
+    printf("burst | ttl | burst (us) | handled per burst | expired per burst\n");
+    run_updates(binding, false);
+    run_updates(binding, true);
+#endif
+}
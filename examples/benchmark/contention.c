@@ -0,0 +1,151 @@
+#include "benchmark.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vivid/util/queue.h>
+
+// Pushes events into one event queue from 1 to 32 producer threads, while the calling thread pops
+// them, and reports the time per event. The queue is lock-free with VIVID_LOCKFREE, and otherwise
+// locked with a pthread mutex, as the binding of the benchmarks has none. A single-producer queue
+// is also timed with one producer thread.
+
+#define MAX_PRODUCERS 32U
+#define QUEUE_SIZE 256U
+
+typedef struct {
+    vivid_queue_t *queue;
+    pthread_t thread;
+    vivid_event_id_t id;
+    size_t num_events;
+    size_t num_retries; // Pushes retried as the queue was full
+} producer_t;
+
+#if !VIVID_LOCKFREE
+static vivid_binding_mutex_t *create_mutex(vivid_binding_t *me)
+{
+    (void)me;
+    pthread_mutex_t *mutex = (pthread_mutex_t *)calloc(1U, sizeof(*mutex));
+    if ((mutex != NULL) && (pthread_mutex_init(mutex, NULL) != 0)) {
+        free(mutex);
+        return NULL;
+    }
+    return (vivid_binding_mutex_t *)mutex;
+}
+
+static bool lock_mutex(vivid_binding_mutex_t *mutex)
+{
+    return pthread_mutex_lock((pthread_mutex_t *)mutex) == 0;
+}
+
+static void unlock_mutex(vivid_binding_mutex_t *mutex)
+{
+    (void)pthread_mutex_unlock((pthread_mutex_t *)mutex);
+}
+
+static void destroy_mutex(vivid_binding_mutex_t *mutex)
+{
+    if (mutex == NULL) {
+        return;
+    }
+    (void)pthread_mutex_destroy((pthread_mutex_t *)mutex);
+    free(mutex);
+}
+#endif
+
+static double get_wall_time(void)
+{
+    struct timespec ts;
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec / 1e9);
+}
+
+static void *produce(void *arg)
+{
+    producer_t *me = (producer_t *)arg;
+    for (size_t i = 0U; i < me->num_events;) {
+        if (vivid_queue_push(me->queue, me->id, "ev_contention" VIVID_PARAM_ARGS(, NULL, VIVID_PARAM_STATIC_ARGS(0U) VIVID_PARAM_DYNAMIC_ARGS(NULL)))) {
+            i++;
+        } else {
+            me->num_retries++;
+            (void)sched_yield();
+        }
+    }
+    return NULL;
+}
+
+// Returns false if the run could not be completed:
+static bool run(vivid_binding_t *binding, vivid_queue_producers_t mode, unsigned num_producers)
+{
+    static producer_t producers[MAX_PRODUCERS];
+    vivid_queue_t *queue = vivid_queue_create_with_producers(binding, QUEUE_SIZE, mode VIVID_PARAM_STATIC_ARGS(, 0U));
+    if (queue == NULL) {
+        printf("contention | could not create queue\n");
+        return false;
+    }
+    size_t num_events = 10U * BENCHMARK_NUM_EVENTS;
+    size_t counts[MAX_PRODUCERS + 1U] = { 0U };
+    double start = get_wall_time();
+    unsigned num_started = 0U;
+    for (; num_started < num_producers; num_started++) {
+        producer_t *producer = &producers[num_started];
+        producer->queue = queue;
+        producer->id = (vivid_event_id_t)(num_started + 1U);
+        producer->num_events = num_events / num_producers;
+        producer->num_retries = 0U;
+        if (pthread_create(&producer->thread, NULL, produce, producer) != 0) {
+            printf("contention | could not create thread\n");
+            break;
+        }
+    }
+    size_t num_expected = num_started * (num_events / num_producers);
+    for (size_t num_popped = 0U; num_popped < num_expected;) {
+        if (vivid_queue_empty(queue)) {
+            (void)sched_yield();
+            continue;
+        }
+        counts[vivid_queue_front(queue)->id]++;
+        vivid_queue_pop(queue);
+        num_popped++;
+    }
+    double time = (get_wall_time() - start) * 1e9 / (double)num_expected;
+    size_t num_retries = 0U;
+    for (unsigned i = 0U; i < num_started; i++) {
+        (void)pthread_join(producers[i].thread, NULL);
+        num_retries += producers[i].num_retries;
+        if (counts[i + 1U] != producers[i].num_events) {
+            printf("contention | producer %u: %zu events popped out of %zu\n", i, counts[i + 1U], producers[i].num_events);
+        }
+    }
+    vivid_queue_destroy(queue);
+    const char *queue_name = !VIVID_LOCKFREE ? "mutex" : (mode == VIVID_QUEUE_SINGLE_PRODUCER) ? "spsc" : "mpsc";
+    printf("contention | %-9s | %9u | %10.1f | %7zu\n", queue_name, num_started, time, num_retries);
+    return num_started == num_producers;
+}
+
+void benchmark_contention(vivid_binding_t *binding)
+{
+    vivid_binding_t locked = *binding;
+#if VIVID_LOG
+    locked.log = NULL; // The producers retry when the queue is full
+#endif
+#if !VIVID_LOCKFREE
+    locked.create_mutex = create_mutex;
+    locked.lock_mutex = lock_mutex;
+    locked.unlock_mutex = unlock_mutex;
+    locked.destroy_mutex = destroy_mutex;
+#endif
+    printf("contention | queue     | producers | event (ns) | retries\n");
+#if VIVID_LOCKFREE
+    // The mutex queue has no single-producer mode:
+    if (!run(&locked, VIVID_QUEUE_SINGLE_PRODUCER, 1U)) {
+        return;
+    }
+#endif
+    for (unsigned num_producers = 1U; num_producers <= MAX_PRODUCERS; num_producers *= 2U) {
+        if (!run(&locked, VIVID_QUEUE_MULTI_PRODUCER, num_producers)) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,167 @@
+#include "benchmark.h"
+#include <stdio.h>
+#include <vivid/sm.h>
+
+// Drives a link state machine with a pseudo-random sequence of events, once interpreted by calling
+// the state functions, once through the dispatcher generated by tools/vivid-gen.py -d, and once
+// written with the C++ front-end, see frontend.cpp. The active states and the trace of the actions
+// are compared after each event, then each engine is timed on its own.
+
+#define NUM_TRACED_EVENTS 100000U
+#define MAX_STATES 8U
+
+typedef struct {
+    vivid_sm_t *vsm;
+    unsigned trace; // Hash of the actions taken so far
+    unsigned count;
+} link_t;
+
+#define STEP(me, k) ((me)->trace = ((me)->trace * 31U) + (k))
+
+VIVID_EVENT_SYNC_PRIVATE(link_t, ev_open, vsm);
+VIVID_EVENT_SYNC_PRIVATE(link_t, ev_close, vsm);
+VIVID_EVENT_SYNC_PRIVATE(link_t, ev_data, vsm);
+VIVID_EVENT_SYNC_PRIVATE(link_t, ev_ack, vsm);
+VIVID_EVENT_SYNC_PRIVATE(link_t, ev_nak, vsm);
+VIVID_EVENT_SYNC_PRIVATE(link_t, ev_ping, vsm);
+VIVID_EVENT_SYNC_PRIVATE(link_t, ev_pong, vsm);
+VIVID_EVENT_SYNC_PRIVATE(link_t, ev_reset, vsm);
+VIVID_EVENT_SYNC_PRIVATE(link_t, ev_tick, vsm);
+VIVID_EVENT_SYNC_PRIVATE(link_t, ev_flush, vsm);
+VIVID_EVENT_SYNC_PRIVATE(link_t, ev_pause, vsm);
+VIVID_EVENT_SYNC_PRIVATE(link_t, ev_resume, vsm);
+
+static void (*const m_events[])(link_t *me) = {
+    ev_open, ev_close, ev_data, ev_ack, ev_nak, ev_ping, ev_pong, ev_reset, ev_tick, ev_flush, ev_pause, ev_resume
+};
+
+VIVID_DECLARE_STATE(root);
+VIVID_DECLARE_STATE(closed);
+VIVID_DECLARE_STATE(open);
+VIVID_DECLARE_STATE(streaming);
+VIVID_DECLARE_STATE(paused);
+
+VIVID_STATE(link_t, root)
+{
+    VIVID_SUB_STATE(closed);
+    VIVID_SUB_STATE(open);
+    VIVID_DEFAULT(closed, VIVID_NO_ACTION);
+    VIVID_ON_EVENT(ev_reset, true, closed, STEP(me, 1U););
+    VIVID_ON_EVENT(ev_ping, true, NULL, STEP(me, 2U););
+}
+
+VIVID_STATE(link_t, closed)
+{
+    VIVID_ON_EVENT(ev_open, true, open, me->count = 0U;);
+    VIVID_ON_EVENT(ev_tick, true, NULL, STEP(me, 3U););
+    VIVID_ON_EVENT(ev_data, (me->trace % 2U) == 0U, NULL, STEP(me, 4U););
+}
+
+VIVID_STATE(link_t, open)
+{
+    VIVID_SUB_STATE(streaming);
+    VIVID_SUB_STATE(paused);
+    VIVID_DEFAULT(streaming, VIVID_NO_ACTION);
+    VIVID_ON_EVENT(ev_close, true, closed, STEP(me, 5U););
+    VIVID_ON_EVENT(ev_tick, me->count > 50U, closed, STEP(me, 6U););
+    VIVID_ON_EVENT(ev_tick, true, NULL, me->count++;);
+}
+
+VIVID_STATE(link_t, streaming)
+{
+    VIVID_ON_EVENT(ev_pause, true, paused, STEP(me, 7U););
+    VIVID_ON_EVENT(ev_ack, true, NULL, me->count++;);
+    VIVID_ON_EVENT(ev_nak, me->count > 0U, NULL, me->count--;);
+    VIVID_ON_EVENT(ev_nak, true, NULL, STEP(me, 8U););
+    VIVID_ON_EVENT(ev_pong, true, NULL, STEP(me, 9U););
+    VIVID_ON_EVENT(ev_flush, me->count > 10U, streaming, me->count = 0U;);
+    VIVID_ON_EVENT(ev_flush, true, NULL, STEP(me, 10U););
+    VIVID_ON_EVENT(ev_ping, (me->count % 3U) == 0U, NULL, STEP(me, 11U););
+    VIVID_ON_EVENT(ev_data, me->count > 100U, paused, STEP(me, 12U););
+    VIVID_ON_EVENT(ev_data, true, NULL, me->count += 2U;);
+}
+
+VIVID_STATE(link_t, paused)
+{
+    VIVID_ON_EVENT(ev_resume, true, streaming, STEP(me, 13U););
+    VIVID_ON_EVENT(ev_data, true, NULL, STEP(me, 14U););
+    VIVID_ON_EVENT(ev_flush, true, streaming, me->count = 0U;);
+}
+
+#include "dispatcher_tables.h"
+
+static unsigned next_random(unsigned *seed)
+{
+    *seed = (*seed * 1103515245U) + 12345U;
+    return *seed >> 16U;
+}
+
+static bool is_same_as_frontend(link_t *a, void *frontend)
+{
+    unsigned trace;
+    unsigned count;
+    unsigned leaf = benchmark_frontend_get(frontend, &trace, &count);
+    unsigned expected_leaf = IS_IN(a->vsm, closed) ? 0U : IS_IN(a->vsm, streaming) ? 1U : 2U;
+    return (leaf == expected_leaf) && (trace == a->trace) && (count == a->count);
+}
+
+static bool is_same(link_t *a, link_t *b)
+{
+    vivid_state_t states_a[MAX_STATES];
+    vivid_state_t states_b[MAX_STATES];
+    size_t num_states = vivid_get_active_states(a->vsm, states_a, MAX_STATES VIVID_LOG_ARGS(, NULL));
+    if ((vivid_get_active_states(b->vsm, states_b, MAX_STATES VIVID_LOG_ARGS(, NULL)) != num_states) || (a->trace != b->trace) || (a->count != b->count)) {
+        return false;
+    }
+    for (size_t i = 0U; i < num_states; i++) {
+        if (states_a[i] != states_b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void benchmark_dispatcher(vivid_binding_t *binding)
+{
+    link_t links[2] = { { 0 } };
+    links[0].vsm = VIVID_CREATE_SM(binding, "interpreted", root, 1U, &links[0]);
+    links[1].vsm = VIVID_CREATE_SM_FROM_TABLES(binding, "generated", root, 1U, &links[1]);
+    void *frontend = benchmark_frontend_create(binding);
+    if ((links[0].vsm == NULL) || (links[1].vsm == NULL) || (frontend == NULL)) {
+        printf("dispatcher | could not create state machine\n");
+        goto error;
+    }
+    benchmark_run(binding);
+    unsigned seed = 1U;
+    for (unsigned i = 0U; i < NUM_TRACED_EVENTS; i++) {
+        unsigned event = next_random(&seed) % (sizeof(m_events) / sizeof(m_events[0]));
+        m_events[event](&links[0]);
+        m_events[event](&links[1]);
+        benchmark_frontend_event(frontend, event);
+        if (!is_same(&links[0], &links[1]) || !is_same_as_frontend(&links[0], frontend)) {
+            printf("dispatcher | traces differ after %u events\n", i + 1U);
+            goto error;
+        }
+    }
+    printf("dispatcher | engine      | event (ns) | traced events\n");
+    static const char *const engines[] = { "interpreted", "generated", "frontend" };
+    for (unsigned engine = 0U; engine < 3U; engine++) {
+        seed = 1U;
+        vivid_time_t start = binding->get_time(binding);
+        for (unsigned i = 0U; i < (10U * BENCHMARK_NUM_EVENTS); i++) {
+            unsigned event = next_random(&seed) % (sizeof(m_events) / sizeof(m_events[0]));
+            if (engine < 2U) {
+                m_events[event](&links[engine]);
+            } else {
+                benchmark_frontend_event(frontend, event);
+            }
+        }
+        double time = (binding->get_time(binding) - start) * 1e9 / (10U * BENCHMARK_NUM_EVENTS);
+        printf("dispatcher | %-11s | %10.1f | %13u\n", engines[engine], time, NUM_TRACED_EVENTS);
+    }
+
+error:
+    benchmark_frontend_destroy(frontend);
+    vivid_destroy_sm(links[1].vsm);
+    vivid_destroy_sm(links[0].vsm);
+}
@@ -0,0 +1,152 @@
+// Generated by vivid-gen.py from dispatcher.c, do not edit.
+// Include after the state functions of dispatcher.c.
+
+#ifndef DISPATCHER_TABLES_H
+#define DISPATCHER_TABLES_H
+
+// Tables of the state machine rooted at root, see vivid_create_sm_class_from_tables():
+static const vivid_node_info_t m_root_nodes[] = {
+    // fn, parent, children, siblings, default_child, depth, subtree_end, type, parallel_children, name, json_props
+    { state_root, VIVID_NODE_INDEX_NONE, 2U, VIVID_NODE_INDEX_NONE, 1U, 0U, 5U, VIVID_NODE_TYPE_ROOT, false VIVID_LOG_ARGS(, "root" VIVID_UML_ARGS(, "")) },
+    { state_closed, 0U, VIVID_NODE_INDEX_NONE, VIVID_NODE_INDEX_NONE, VIVID_NODE_INDEX_NONE, 1U, 2U, VIVID_NODE_TYPE_STATE, false VIVID_LOG_ARGS(, "closed" VIVID_UML_ARGS(, "")) },
+    { state_open, 0U, 4U, 1U, 3U, 1U, 5U, VIVID_NODE_TYPE_STATE, false VIVID_LOG_ARGS(, "open" VIVID_UML_ARGS(, "")) },
+    { state_streaming, 2U, VIVID_NODE_INDEX_NONE, VIVID_NODE_INDEX_NONE, VIVID_NODE_INDEX_NONE, 2U, 4U, VIVID_NODE_TYPE_STATE, false VIVID_LOG_ARGS(, "streaming" VIVID_UML_ARGS(, "")) },
+    { state_paused, 2U, VIVID_NODE_INDEX_NONE, 3U, VIVID_NODE_INDEX_NONE, 2U, 5U, VIVID_NODE_TYPE_STATE, false VIVID_LOG_ARGS(, "paused" VIVID_UML_ARGS(, "")) },
+};
+
+static vivid_event_t *const m_root_no_events[] = { NULL };
+static vivid_event_t *const m_root_root_events[] = { &m_ev_reset_event, &m_ev_ping_event, NULL };
+static vivid_event_t *const m_root_closed_events[] = { &m_ev_open_event, &m_ev_tick_event, &m_ev_data_event, NULL };
+static vivid_event_t *const m_root_open_events[] = { &m_ev_close_event, &m_ev_tick_event, NULL };
+static vivid_event_t *const m_root_streaming_events[] = { &m_ev_pause_event, &m_ev_ack_event, &m_ev_nak_event, &m_ev_pong_event, &m_ev_flush_event, &m_ev_ping_event, &m_ev_data_event, NULL };
+static vivid_event_t *const m_root_paused_events[] = { &m_ev_resume_event, &m_ev_data_event, &m_ev_flush_event, NULL };
+
+static const vivid_node_handlers_t m_root_handlers[] = {
+    // events, jumps, timers
+    { m_root_root_events, false, false },
+    { m_root_closed_events, false, false },
+    { m_root_open_events, false, false },
+    { m_root_streaming_events, false, false },
+    { m_root_paused_events, false, false },
+};
+
+static vivid_event_t *const m_root_events[] = { &m_ev_reset_event, &m_ev_ping_event, &m_ev_open_event, &m_ev_tick_event, &m_ev_data_event, &m_ev_close_event, &m_ev_pause_event, &m_ev_ack_event, &m_ev_nak_event, &m_ev_pong_event, &m_ev_flush_event, &m_ev_resume_event, NULL };
+
+// Handlers of each event in each state, see vivid_dispatch_t:
+static void m_root_dispatch(vivid_node_t *node, void *app, size_t node_index, size_t event_index)
+{
+    switch ((node_index * 12U) + event_index) {
+    case (0U * 12U) + 0U: { // root, ev_reset
+        link_t *me = (link_t *)app;
+        (void)me;
+        VIVID_ON_EVENT(ev_reset, true, closed, STEP(me, 1U););
+        break;
+    }
+    case (0U * 12U) + 1U: { // root, ev_ping
+        link_t *me = (link_t *)app;
+        (void)me;
+        VIVID_ON_EVENT(ev_ping, true, NULL, STEP(me, 2U););
+        break;
+    }
+    case (1U * 12U) + 2U: { // closed, ev_open
+        link_t *me = (link_t *)app;
+        (void)me;
+        VIVID_ON_EVENT(ev_open, true, open, me->count = 0U;);
+        break;
+    }
+    case (1U * 12U) + 3U: { // closed, ev_tick
+        link_t *me = (link_t *)app;
+        (void)me;
+        VIVID_ON_EVENT(ev_tick, true, NULL, STEP(me, 3U););
+        break;
+    }
+    case (1U * 12U) + 4U: { // closed, ev_data
+        link_t *me = (link_t *)app;
+        (void)me;
+        VIVID_ON_EVENT(ev_data, (me->trace % 2U) == 0U, NULL, STEP(me, 4U););
+        break;
+    }
+    case (2U * 12U) + 5U: { // open, ev_close
+        link_t *me = (link_t *)app;
+        (void)me;
+        VIVID_ON_EVENT(ev_close, true, closed, STEP(me, 5U););
+        break;
+    }
+    case (2U * 12U) + 3U: { // open, ev_tick
+        link_t *me = (link_t *)app;
+        (void)me;
+        VIVID_ON_EVENT(ev_tick, me->count > 50U, closed, STEP(me, 6U););
+        VIVID_ON_EVENT(ev_tick, true, NULL, me->count++;);
+        break;
+    }
+    case (3U * 12U) + 6U: { // streaming, ev_pause
+        link_t *me = (link_t *)app;
+        (void)me;
+        VIVID_ON_EVENT(ev_pause, true, paused, STEP(me, 7U););
+        break;
+    }
+    case (3U * 12U) + 7U: { // streaming, ev_ack
+        link_t *me = (link_t *)app;
+        (void)me;
+        VIVID_ON_EVENT(ev_ack, true, NULL, me->count++;);
+        break;
+    }
+    case (3U * 12U) + 8U: { // streaming, ev_nak
+        link_t *me = (link_t *)app;
+        (void)me;
+        VIVID_ON_EVENT(ev_nak, me->count > 0U, NULL, me->count--;);
+        VIVID_ON_EVENT(ev_nak, true, NULL, STEP(me, 8U););
+        break;
+    }
+    case (3U * 12U) + 9U: { // streaming, ev_pong
+        link_t *me = (link_t *)app;
+        (void)me;
+        VIVID_ON_EVENT(ev_pong, true, NULL, STEP(me, 9U););
+        break;
+    }
+    case (3U * 12U) + 10U: { // streaming, ev_flush
+        link_t *me = (link_t *)app;
+        (void)me;
+        VIVID_ON_EVENT(ev_flush, me->count > 10U, streaming, me->count = 0U;);
+        VIVID_ON_EVENT(ev_flush, true, NULL, STEP(me, 10U););
+        break;
+    }
+    case (3U * 12U) + 1U: { // streaming, ev_ping
+        link_t *me = (link_t *)app;
+        (void)me;
+        VIVID_ON_EVENT(ev_ping, (me->count % 3U) == 0U, NULL, STEP(me, 11U););
+        break;
+    }
+    case (3U * 12U) + 4U: { // streaming, ev_data
+        link_t *me = (link_t *)app;
+        (void)me;
+        VIVID_ON_EVENT(ev_data, me->count > 100U, paused, STEP(me, 12U););
+        VIVID_ON_EVENT(ev_data, true, NULL, me->count += 2U;);
+        break;
+    }
+    case (4U * 12U) + 11U: { // paused, ev_resume
+        link_t *me = (link_t *)app;
+        (void)me;
+        VIVID_ON_EVENT(ev_resume, true, streaming, STEP(me, 13U););
+        break;
+    }
+    case (4U * 12U) + 4U: { // paused, ev_data
+        link_t *me = (link_t *)app;
+        (void)me;
+        VIVID_ON_EVENT(ev_data, true, NULL, STEP(me, 14U););
+        break;
+    }
+    case (4U * 12U) + 10U: { // paused, ev_flush
+        link_t *me = (link_t *)app;
+        (void)me;
+        VIVID_ON_EVENT(ev_flush, true, streaming, me->count = 0U;);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static const vivid_sm_tables_t m_root_tables = { m_root_nodes, m_root_handlers, 5U, m_root_events, m_root_dispatch VIVID_PARAM_STATIC_ARGS(, 0U) };
+
+#endif
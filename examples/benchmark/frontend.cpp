@@ -0,0 +1,227 @@
+#include "benchmark.h"
+#include <vivid/sm.hpp>
+
+// The link state machine of dispatcher.c, written with the C++ front-end of vivid/sm.hpp, for
+// dispatcher.c to compare and time it along with the C engines.
+
+namespace {
+
+struct Link;
+
+struct closed;
+struct open;
+struct streaming;
+struct paused;
+struct root : vivid::composite<closed, open> {
+};
+struct closed {
+};
+struct open : vivid::composite<streaming, paused> {
+};
+struct streaming {
+};
+struct paused {
+};
+
+struct ev_open {
+};
+struct ev_close {
+};
+struct ev_data {
+};
+struct ev_ack {
+};
+struct ev_nak {
+};
+struct ev_ping {
+};
+struct ev_pong {
+};
+struct ev_reset {
+};
+struct ev_tick {
+};
+struct ev_flush {
+};
+struct ev_pause {
+};
+struct ev_resume {
+};
+
+template <unsigned K, typename Event>
+void step(Link &me, const Event &event);
+
+template <typename Event>
+void reset_count(Link &me, const Event &event);
+
+template <typename Event>
+void increment_count(Link &me, const Event &event);
+
+bool is_trace_even(Link &me, const ev_data &event);
+bool is_count_above_0(Link &me, const ev_nak &event);
+bool is_count_above_10(Link &me, const ev_flush &event);
+bool is_count_above_50(Link &me, const ev_tick &event);
+bool is_count_above_100(Link &me, const ev_data &event);
+bool is_count_multiple_of_3(Link &me, const ev_ping &event);
+void decrement_count(Link &me, const ev_nak &event);
+void add_2_to_count(Link &me, const ev_data &event);
+
+// In the order of the handlers of each state function of dispatcher.c:
+using transitions = vivid::list<
+    vivid::on_event<root, ev_reset, closed, step<1U, ev_reset>>,
+    vivid::on_event<root, ev_ping, void, step<2U, ev_ping>>,
+    vivid::on_event<closed, ev_open, open, reset_count<ev_open>>,
+    vivid::on_event<closed, ev_tick, void, step<3U, ev_tick>>,
+    vivid::on_event<closed, ev_data, void, step<4U, ev_data>, is_trace_even>,
+    vivid::on_event<open, ev_close, closed, step<5U, ev_close>>,
+    vivid::on_event<open, ev_tick, closed, step<6U, ev_tick>, is_count_above_50>,
+    vivid::on_event<open, ev_tick, void, increment_count<ev_tick>>,
+    vivid::on_event<streaming, ev_pause, paused, step<7U, ev_pause>>,
+    vivid::on_event<streaming, ev_ack, void, increment_count<ev_ack>>,
+    vivid::on_event<streaming, ev_nak, void, decrement_count, is_count_above_0>,
+    vivid::on_event<streaming, ev_nak, void, step<8U, ev_nak>>,
+    vivid::on_event<streaming, ev_pong, void, step<9U, ev_pong>>,
+    vivid::on_event<streaming, ev_flush, streaming, reset_count<ev_flush>, is_count_above_10>,
+    vivid::on_event<streaming, ev_flush, void, step<10U, ev_flush>>,
+    vivid::on_event<streaming, ev_ping, void, step<11U, ev_ping>, is_count_multiple_of_3>,
+    vivid::on_event<streaming, ev_data, paused, step<12U, ev_data>, is_count_above_100>,
+    vivid::on_event<streaming, ev_data, void, add_2_to_count>,
+    vivid::on_event<paused, ev_resume, streaming, step<13U, ev_resume>>,
+    vivid::on_event<paused, ev_data, void, step<14U, ev_data>>,
+    vivid::on_event<paused, ev_flush, streaming, reset_count<ev_flush>>>;
+
+struct Link {
+    Link(vivid_binding_t *binding)
+        : vsm(binding, *this)
+    {
+    }
+    vivid::sm<Link, root, transitions, 1U> vsm;
+    unsigned trace {}; // Hash of the actions taken so far
+    unsigned count {};
+};
+
+template <unsigned K, typename Event>
+void step(Link &me, const Event &)
+{
+    me.trace = (me.trace * 31U) + K;
+}
+
+template <typename Event>
+void reset_count(Link &me, const Event &)
+{
+    me.count = 0U;
+}
+
+template <typename Event>
+void increment_count(Link &me, const Event &)
+{
+    me.count++;
+}
+
+bool is_trace_even(Link &me, const ev_data &)
+{
+    return (me.trace % 2U) == 0U;
+}
+
+bool is_count_above_0(Link &me, const ev_nak &)
+{
+    return me.count > 0U;
+}
+
+bool is_count_above_10(Link &me, const ev_flush &)
+{
+    return me.count > 10U;
+}
+
+bool is_count_above_50(Link &me, const ev_tick &)
+{
+    return me.count > 50U;
+}
+
+bool is_count_above_100(Link &me, const ev_data &)
+{
+    return me.count > 100U;
+}
+
+bool is_count_multiple_of_3(Link &me, const ev_ping &)
+{
+    return (me.count % 3U) == 0U;
+}
+
+void decrement_count(Link &me, const ev_nak &)
+{
+    me.count--;
+}
+
+void add_2_to_count(Link &me, const ev_data &)
+{
+    me.count += 2U;
+}
+
+} // namespace
+
+void *benchmark_frontend_create(vivid_binding_t *binding)
+{
+    Link *me = new Link(binding);
+    if (!me->vsm.valid()) {
+        delete me;
+        return nullptr;
+    }
+    return me;
+}
+
+void benchmark_frontend_destroy(void *link)
+{
+    delete static_cast<Link *>(link);
+}
+
+void benchmark_frontend_event(void *link, unsigned event)
+{
+    auto &vsm = static_cast<Link *>(link)->vsm;
+    switch (event) {
+    case 0U:
+        vsm.dispatch(ev_open {});
+        break;
+    case 1U:
+        vsm.dispatch(ev_close {});
+        break;
+    case 2U:
+        vsm.dispatch(ev_data {});
+        break;
+    case 3U:
+        vsm.dispatch(ev_ack {});
+        break;
+    case 4U:
+        vsm.dispatch(ev_nak {});
+        break;
+    case 5U:
+        vsm.dispatch(ev_ping {});
+        break;
+    case 6U:
+        vsm.dispatch(ev_pong {});
+        break;
+    case 7U:
+        vsm.dispatch(ev_reset {});
+        break;
+    case 8U:
+        vsm.dispatch(ev_tick {});
+        break;
+    case 9U:
+        vsm.dispatch(ev_flush {});
+        break;
+    case 10U:
+        vsm.dispatch(ev_pause {});
+        break;
+    default:
+        vsm.dispatch(ev_resume {});
+        break;
+    }
+}
+
+unsigned benchmark_frontend_get(void *link, unsigned *trace, unsigned *count)
+{
+    Link *me = static_cast<Link *>(link);
+    *trace = me->trace;
+    *count = me->count;
+    return me->vsm.is_in<closed>() ? 0U : me->vsm.is_in<streaming>() ? 1U : 2U;
+}
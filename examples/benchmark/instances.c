@@ -0,0 +1,213 @@
+#include "benchmark.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <vivid/sm.h>
+
+// Creates many instances of a session state machine, each with its own topology or all sharing
+// the topology of one class, recorded by walking the state functions or taken from the tables
+// generated by tools/vivid-gen.py -t, and reports the time taken and the memory held per instance.
+// The instances are then started and given a few events, to check that they all run, and the
+// binding timers held are counted before and after.
+
+#define NUM_INSTANCES 100000U
+#define NUM_CLASSES 1000U
+
+typedef struct {
+    vivid_sm_t *vsm;
+    unsigned num_packets;
+} session_t;
+
+VIVID_EVENT_PUBLIC(session_t, session, ev_connect, vsm);
+VIVID_EVENT_PRIVATE(session_t, ev_connected, vsm);
+VIVID_EVENT_PRIVATE(session_t, ev_packet, vsm);
+VIVID_EVENT_PRIVATE(session_t, ev_close, vsm);
+
+VIVID_DECLARE_STATE(root);
+VIVID_DECLARE_STATE(idle);
+VIVID_DECLARE_STATE(connecting);
+VIVID_DECLARE_STATE(connected);
+VIVID_DECLARE_STATE(authenticating);
+VIVID_DECLARE_STATE(ready);
+VIVID_DECLARE_STATE(streaming);
+VIVID_DECLARE_STATE(closing);
+
+#include "instances_tables.h"
+
+VIVID_STATE(session_t, root)
+{
+    VIVID_SUB_STATE(idle);
+    VIVID_SUB_STATE(connecting);
+    VIVID_SUB_STATE(connected);
+    VIVID_SUB_STATE(closing);
+    VIVID_DEFAULT(idle, VIVID_NO_ACTION);
+}
+
+VIVID_STATE(session_t, idle)
+{
+    VIVID_ON_EVENT(ev_connect, true, connecting, VIVID_NO_ACTION);
+}
+
+VIVID_STATE(session_t, connecting)
+{
+    VIVID_ON_EVENT(ev_connected, true, connected, VIVID_NO_ACTION);
+    VIVID_ON_TIMEOUT(connect_timeout, 10, true, idle, VIVID_NO_ACTION);
+}
+
+VIVID_STATE(session_t, connected)
+{
+    VIVID_SUB_STATE(authenticating);
+    VIVID_SUB_STATE(ready);
+    VIVID_SUB_STATE(streaming);
+    VIVID_DEFAULT(authenticating, VIVID_NO_ACTION);
+    VIVID_ON_EVENT(ev_close, true, closing, VIVID_NO_ACTION);
+}
+
+VIVID_STATE(session_t, authenticating)
+{
+    VIVID_ON_EVENT(ev_packet, true, ready, VIVID_NO_ACTION);
+}
+
+VIVID_STATE(session_t, ready)
+{
+    VIVID_ON_EVENT(ev_packet, true, streaming, me->num_packets++;);
+}
+
+VIVID_STATE(session_t, streaming)
+{
+    VIVID_ON_EVENT(ev_packet, true, NULL, me->num_packets++;);
+}
+
+VIVID_STATE(session_t, closing)
+{
+    VIVID_ON_TIMEOUT(close_timeout, 1, true, idle, VIVID_NO_ACTION);
+}
+
+// Counts the bytes held through a binding, with the size of each allocation in front of it, and
+// the binding timers:
+static vivid_binding_t *m_binding;
+static size_t m_num_bytes;
+static size_t m_num_timers;
+
+static void *calloc_counted(vivid_binding_t *me, size_t num, size_t size)
+{
+    size_t *mem = (size_t *)m_binding->calloc(me, 1U, sizeof(size_t) + (num * size));
+    if (mem == NULL) {
+        return NULL;
+    }
+    mem[0] = num * size;
+    m_num_bytes += mem[0];
+    return &mem[1];
+}
+
+static void free_counted(void *mem)
+{
+    if (mem == NULL) {
+        return;
+    }
+    size_t *header = (size_t *)mem - 1;
+    m_num_bytes -= *header;
+    m_binding->free(header);
+}
+
+static vivid_binding_timer_t *create_timer_counted(vivid_binding_t *me, vivid_binding_callback_t callback, void *data)
+{
+    vivid_binding_timer_t *timer = m_binding->create_timer(me, callback, data);
+    if (timer != NULL) {
+        m_num_timers++;
+    }
+    return timer;
+}
+
+static void destroy_timer_counted(vivid_binding_timer_t *timer)
+{
+    if (timer != NULL) {
+        m_num_timers--;
+    }
+    m_binding->destroy_timer(timer);
+}
+
+void benchmark_instances(vivid_binding_t *binding)
+{
+    session_t *sessions = (session_t *)calloc(NUM_INSTANCES, sizeof(*sessions));
+    if (sessions == NULL) {
+        printf("instances | could not allocate sessions\n");
+        return;
+    }
+    m_binding = binding;
+    vivid_binding_t counted = *binding;
+    counted.calloc = calloc_counted;
+    counted.free = free_counted;
+    counted.create_timer = create_timer_counted;
+    counted.destroy_timer = destroy_timer_counted;
+    // Time the creation of the topology on its own, which each own instance repeats, before the
+    // instances leave the heap fragmented:
+    double class_times[2];
+    for (unsigned tables = 0U; tables < 2U; tables++) {
+        vivid_time_t start = binding->get_time(binding);
+        for (size_t i = 0U; i < NUM_CLASSES; i++) {
+            vivid_destroy_sm_class(tables ? VIVID_CREATE_SM_CLASS_FROM_TABLES(binding, "session", root, NULL)
+                                          : VIVID_CREATE_SM_CLASS(binding, "session", root, NULL));
+        }
+        class_times[tables] = (binding->get_time(binding) - start) * 1e9 / NUM_CLASSES;
+    }
+    printf("instances | instances | topology     | instance (ns) | instance (bytes) | class (ns) | class (bytes) | timers (new) | timers (run)\n");
+    for (unsigned mode = 0U; mode < 4U; mode++) {
+        bool shared = mode >= 2U;
+        bool tables = (mode % 2U) != 0U;
+        vivid_sm_class_t *sm_class = NULL;
+        m_num_bytes = 0U;
+        if (shared) {
+            sm_class = tables ? VIVID_CREATE_SM_CLASS_FROM_TABLES(&counted, "session", root, NULL)
+                              : VIVID_CREATE_SM_CLASS(&counted, "session", root, NULL);
+            if (sm_class == NULL) {
+                printf("instances | could not create state machine class\n");
+                break;
+            }
+        }
+        size_t class_bytes = m_num_bytes;
+        m_num_bytes = 0U;
+        size_t num_instances = 0U;
+        vivid_time_t start = binding->get_time(binding);
+        for (; num_instances < NUM_INSTANCES; num_instances++) {
+            session_t *session = &sessions[num_instances];
+            session->num_packets = 0U;
+            if (shared) {
+                session->vsm = VIVID_CREATE_SM_FROM_CLASS(&counted, "session", sm_class, 8U, 1U, session);
+            } else {
+                session->vsm = tables ? VIVID_CREATE_SM_FROM_TABLES(&counted, "session", root, 8U, session)
+                                      : VIVID_CREATE_SM(&counted, "session", root, 8U, session);
+            }
+            if (session->vsm == NULL) {
+                printf("instances | could not create state machine\n");
+                break;
+            }
+        }
+        double time = (binding->get_time(binding) - start) * 1e9 / NUM_INSTANCES;
+        if (num_instances == NUM_INSTANCES) {
+            size_t num_timers = m_num_timers;
+            double num_bytes = (double)m_num_bytes / NUM_INSTANCES;
+            benchmark_run(binding);
+            for (size_t i = 0U; i < NUM_INSTANCES; i++) {
+                session_ev_connect(&sessions[i]);
+                ev_connected(&sessions[i]);
+                ev_packet(&sessions[i]);
+                ev_packet(&sessions[i]);
+                ev_close(&sessions[i]);
+            }
+            benchmark_run(binding);
+            printf("instances | %9u | %5s %6s | %13.1f | %16.1f | %10.1f | %13zu | %12zu | %12zu\n", NUM_INSTANCES, shared ? "class" : "own", tables ? "tables" : "walked", time, num_bytes, class_times[tables], class_bytes, num_timers, m_num_timers);
+            for (size_t i = 0U; i < NUM_INSTANCES; i++) {
+                if (!IS_IN(sessions[i].vsm, closing) || (sessions[i].num_packets != 1U)) {
+                    printf("instances | unexpected state\n");
+                    break;
+                }
+            }
+        }
+        // Destroy the newest instances first, as the binding keeps its events in a list, newest first:
+        while (num_instances > 0U) {
+            vivid_destroy_sm(sessions[--num_instances].vsm);
+        }
+        vivid_destroy_sm_class(sm_class);
+    }
+    free(sessions);
+}
@@ -0,0 +1,44 @@
+// Generated by vivid-gen.py from instances.c, do not edit.
+// Include after the events and the state declarations of instances.c.
+
+#ifndef INSTANCES_TABLES_H
+#define INSTANCES_TABLES_H
+
+// Tables of the state machine rooted at root, see vivid_create_sm_class_from_tables():
+static const vivid_node_info_t m_root_nodes[] = {
+    // fn, parent, children, siblings, default_child, depth, subtree_end, type, parallel_children, name, json_props
+    { state_root, VIVID_NODE_INDEX_NONE, 7U, VIVID_NODE_INDEX_NONE, 1U, 0U, 8U, VIVID_NODE_TYPE_ROOT, false VIVID_LOG_ARGS(, "root" VIVID_UML_ARGS(, "")) },
+    { state_idle, 0U, VIVID_NODE_INDEX_NONE, VIVID_NODE_INDEX_NONE, VIVID_NODE_INDEX_NONE, 1U, 2U, VIVID_NODE_TYPE_STATE, false VIVID_LOG_ARGS(, "idle" VIVID_UML_ARGS(, "")) },
+    { state_connecting, 0U, VIVID_NODE_INDEX_NONE, 1U, VIVID_NODE_INDEX_NONE, 1U, 3U, VIVID_NODE_TYPE_STATE, false VIVID_LOG_ARGS(, "connecting" VIVID_UML_ARGS(, "")) },
+    { state_connected, 0U, 6U, 2U, 4U, 1U, 7U, VIVID_NODE_TYPE_STATE, false VIVID_LOG_ARGS(, "connected" VIVID_UML_ARGS(, "")) },
+    { state_authenticating, 3U, VIVID_NODE_INDEX_NONE, VIVID_NODE_INDEX_NONE, VIVID_NODE_INDEX_NONE, 2U, 5U, VIVID_NODE_TYPE_STATE, false VIVID_LOG_ARGS(, "authenticating" VIVID_UML_ARGS(, "")) },
+    { state_ready, 3U, VIVID_NODE_INDEX_NONE, 4U, VIVID_NODE_INDEX_NONE, 2U, 6U, VIVID_NODE_TYPE_STATE, false VIVID_LOG_ARGS(, "ready" VIVID_UML_ARGS(, "")) },
+    { state_streaming, 3U, VIVID_NODE_INDEX_NONE, 5U, VIVID_NODE_INDEX_NONE, 2U, 7U, VIVID_NODE_TYPE_STATE, false VIVID_LOG_ARGS(, "streaming" VIVID_UML_ARGS(, "")) },
+    { state_closing, 0U, VIVID_NODE_INDEX_NONE, 3U, VIVID_NODE_INDEX_NONE, 1U, 8U, VIVID_NODE_TYPE_STATE, false VIVID_LOG_ARGS(, "closing" VIVID_UML_ARGS(, "")) },
+};
+
+static vivid_event_t *const m_root_no_events[] = { NULL };
+static vivid_event_t *const m_root_idle_events[] = { &m_ev_connect_event, NULL };
+static vivid_event_t *const m_root_connecting_events[] = { &m_ev_connected_event, NULL };
+static vivid_event_t *const m_root_connected_events[] = { &m_ev_close_event, NULL };
+static vivid_event_t *const m_root_authenticating_events[] = { &m_ev_packet_event, NULL };
+static vivid_event_t *const m_root_ready_events[] = { &m_ev_packet_event, NULL };
+static vivid_event_t *const m_root_streaming_events[] = { &m_ev_packet_event, NULL };
+
+static const vivid_node_handlers_t m_root_handlers[] = {
+    // events, jumps, timers
+    { m_root_no_events, false, false },
+    { m_root_idle_events, false, false },
+    { m_root_connecting_events, false, true },
+    { m_root_connected_events, false, false },
+    { m_root_authenticating_events, false, false },
+    { m_root_ready_events, false, false },
+    { m_root_streaming_events, false, false },
+    { m_root_no_events, false, true },
+};
+
+static vivid_event_t *const m_root_events[] = { &m_ev_connect_event, &m_ev_connected_event, &m_ev_close_event, &m_ev_packet_event, NULL };
+
+static const vivid_sm_tables_t m_root_tables = { m_root_nodes, m_root_handlers, 8U, m_root_events, NULL VIVID_PARAM_STATIC_ARGS(, 0U) };
+
+#endif
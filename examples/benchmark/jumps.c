@@ -0,0 +1,130 @@
+#include "benchmark.h"
+#include <stdio.h>
+#include <vivid/sm.h>
+
+// Runs an event through a chain of conditions, next to parallel regions whose states wait on a
+// jump guard. Only the conditions entered along the chain should have their jumps evaluated.
+
+#define NUM_CONDITIONS 16U
+
+typedef struct {
+    vivid_sm_t *vsm;
+    unsigned count;
+    unsigned num_watches;
+} jumps_t;
+
+VIVID_EVENT_PUBLIC(jumps_t, jumps, ev_go, vsm);
+
+VIVID_DECLARE_STATE(root);
+VIVID_DECLARE_STATE(chain);
+VIVID_DECLARE_STATE(idle);
+VIVID_DECLARE_STATE(watchers);
+
+#define CONDITION(n, next)                    \
+    VIVID_DECLARE_STATE(cond_##n);            \
+    VIVID_STATE(jumps_t, cond_##n)            \
+    {                                         \
+        VIVID_JUMP(true, next, me->count++;); \
+    }
+
+#define WATCHER(n)                                                     \
+    VIVID_DECLARE_STATE(watcher_##n);                                  \
+    VIVID_STATE(jumps_t, watcher_##n)                                  \
+    {                                                                  \
+        VIVID_JUMP((me->num_watches++, false), NULL, VIVID_NO_ACTION); \
+    }
+
+CONDITION(15, idle)
+CONDITION(14, cond_15)
+CONDITION(13, cond_14)
+CONDITION(12, cond_13)
+CONDITION(11, cond_12)
+CONDITION(10, cond_11)
+CONDITION(9, cond_10)
+CONDITION(8, cond_9)
+CONDITION(7, cond_8)
+CONDITION(6, cond_7)
+CONDITION(5, cond_6)
+CONDITION(4, cond_5)
+CONDITION(3, cond_4)
+CONDITION(2, cond_3)
+CONDITION(1, cond_2)
+CONDITION(0, cond_1)
+
+WATCHER(0)
+WATCHER(1)
+WATCHER(2)
+WATCHER(3)
+WATCHER(4)
+WATCHER(5)
+WATCHER(6)
+WATCHER(7)
+
+VIVID_STATE(jumps_t, root)
+{
+    VIVID_SUB_STATE_PARALLEL(chain);
+    VIVID_SUB_STATE_PARALLEL(watchers);
+}
+
+VIVID_STATE(jumps_t, watchers)
+{
+    VIVID_SUB_STATE_PARALLEL(watcher_0);
+    VIVID_SUB_STATE_PARALLEL(watcher_1);
+    VIVID_SUB_STATE_PARALLEL(watcher_2);
+    VIVID_SUB_STATE_PARALLEL(watcher_3);
+    VIVID_SUB_STATE_PARALLEL(watcher_4);
+    VIVID_SUB_STATE_PARALLEL(watcher_5);
+    VIVID_SUB_STATE_PARALLEL(watcher_6);
+    VIVID_SUB_STATE_PARALLEL(watcher_7);
+}
+
+VIVID_STATE(jumps_t, chain)
+{
+    VIVID_SUB_STATE(idle);
+    VIVID_SUB_CONDITION(cond_0);
+    VIVID_SUB_CONDITION(cond_1);
+    VIVID_SUB_CONDITION(cond_2);
+    VIVID_SUB_CONDITION(cond_3);
+    VIVID_SUB_CONDITION(cond_4);
+    VIVID_SUB_CONDITION(cond_5);
+    VIVID_SUB_CONDITION(cond_6);
+    VIVID_SUB_CONDITION(cond_7);
+    VIVID_SUB_CONDITION(cond_8);
+    VIVID_SUB_CONDITION(cond_9);
+    VIVID_SUB_CONDITION(cond_10);
+    VIVID_SUB_CONDITION(cond_11);
+    VIVID_SUB_CONDITION(cond_12);
+    VIVID_SUB_CONDITION(cond_13);
+    VIVID_SUB_CONDITION(cond_14);
+    VIVID_SUB_CONDITION(cond_15);
+    VIVID_DEFAULT(idle, VIVID_NO_ACTION);
+}
+
+VIVID_STATE(jumps_t, idle)
+{
+    VIVID_ON_EVENT(ev_go, true, cond_0, VIVID_NO_ACTION);
+}
+
+void benchmark_jumps(vivid_binding_t *binding)
+{
+    jumps_t me = { 0 };
+    me.vsm = VIVID_CREATE_SM(binding, "jumps", root, 1U, &me);
+    if (me.vsm == NULL) {
+        printf("jumps | could not create state machine\n");
+        return;
+    }
+    benchmark_run(binding);
+    me.num_watches = 0U;
+    vivid_time_t start = binding->get_time(binding);
+    for (unsigned i = 0U; i < BENCHMARK_NUM_EVENTS; i++) {
+        jumps_ev_go(&me);
+        benchmark_run(binding);
+    }
+    double time = (binding->get_time(binding) - start) * 1e9 / BENCHMARK_NUM_EVENTS;
+    printf("jumps | conditions | event (ns) | watcher guards per event\n");
+    printf("jumps | %10u | %10.1f | %24.1f\n", NUM_CONDITIONS, time, (double)me.num_watches / BENCHMARK_NUM_EVENTS);
+    if ((me.count != (NUM_CONDITIONS * BENCHMARK_NUM_EVENTS)) || !IS_IN(me.vsm, idle)) {
+        printf("jumps | unexpected state\n");
+    }
+    vivid_destroy_sm(me.vsm);
+}
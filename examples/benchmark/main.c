@@ -0,0 +1,219 @@
+#include "benchmark.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// A single-threaded binding that dispatches triggered events from benchmark_run(), so that the
+// benchmarks measure the state machine rather than the operating system.
+
+struct vivid_binding_data {
+    vivid_binding_event_t *events;
+};
+
+struct vivid_binding_event {
+    vivid_binding_t *binding;
+    vivid_binding_callback_t callback;
+    void *data;
+    bool trig;
+    vivid_binding_event_t *next;
+};
+
+struct vivid_binding_timer {
+    vivid_binding_t *binding;
+};
+
+#if !VIVID_LOCKFREE
+struct vivid_binding_mutex {
+    vivid_binding_t *binding;
+};
+#endif
+
+static void *calloc_mem(vivid_binding_t *me, size_t num, size_t size)
+{
+    (void)me;
+    return calloc(num, size);
+}
+
+static void free_mem(void *mem)
+{
+    free(mem);
+}
+
+static vivid_binding_event_t *create_event(vivid_binding_t *me, vivid_binding_callback_t callback, void *data)
+{
+    vivid_binding_event_t *event = (vivid_binding_event_t *)me->calloc(me, 1U, sizeof(*event));
+    if (event == NULL) {
+        return NULL;
+    }
+    event->binding = me;
+    event->callback = callback;
+    event->data = data;
+    event->next = me->data->events;
+    me->data->events = event;
+    return event;
+}
+
+static void trigger_event(vivid_binding_event_t *event)
+{
+    event->trig = true;
+}
+
+static void destroy_event(vivid_binding_event_t *event)
+{
+    if (event == NULL) {
+        return;
+    }
+    vivid_binding_event_t **next = &event->binding->data->events;
+    while (*next != event) {
+        next = &(*next)->next;
+    }
+    *next = event->next;
+    event->binding->free(event);
+}
+
+static vivid_binding_timer_t *create_timer(vivid_binding_t *me, vivid_binding_callback_t callback, void *data)
+{
+    (void)callback;
+    (void)data;
+    vivid_binding_timer_t *timer = (vivid_binding_timer_t *)me->calloc(me, 1U, sizeof(*timer));
+    if (timer == NULL) {
+        return NULL;
+    }
+    timer->binding = me;
+    return timer;
+}
+
+static void start_timer(vivid_binding_timer_t *timer, vivid_time_t timeout)
+{
+    (void)timer;
+    (void)timeout;
+}
+
+static void stop_timer(vivid_binding_timer_t *timer)
+{
+    (void)timer;
+}
+
+static void destroy_timer(vivid_binding_timer_t *timer)
+{
+    if (timer == NULL) {
+        return;
+    }
+    timer->binding->free(timer);
+}
+
+static vivid_time_t get_time(vivid_binding_t *me)
+{
+    (void)me;
+    return (vivid_time_t)clock() / CLOCKS_PER_SEC;
+}
+
+static void sleep_time(vivid_binding_t *me, vivid_time_t time)
+{
+    (void)me;
+    (void)time;
+}
+
+#if !VIVID_LOCKFREE
+static vivid_binding_mutex_t *create_mutex(vivid_binding_t *me)
+{
+    vivid_binding_mutex_t *mutex = (vivid_binding_mutex_t *)me->calloc(me, 1U, sizeof(*mutex));
+    if (mutex == NULL) {
+        return NULL;
+    }
+    mutex->binding = me;
+    return mutex;
+}
+
+static bool lock_mutex(vivid_binding_mutex_t *mutex)
+{
+    (void)mutex;
+    return true;
+}
+
+static void unlock_mutex(vivid_binding_mutex_t *mutex)
+{
+    (void)mutex;
+}
+
+static void destroy_mutex(vivid_binding_mutex_t *mutex)
+{
+    if (mutex == NULL) {
+        return;
+    }
+    mutex->binding->free(mutex);
+}
+#endif
+
+#if VIVID_LOG
+static void print_message(void *logger, vivid_log_level_t level, const char *message)
+{
+    (void)logger;
+    if (level <= VIVID_LOG_LEVEL_WARN) {
+        printf("%s\n", message);
+    }
+}
+#endif
+
+size_t benchmark_run(vivid_binding_t *binding)
+{
+    size_t num_callbacks = 0U;
+    bool trig = true;
+    while (trig) {
+        trig = false;
+        for (vivid_binding_event_t *event = binding->data->events; event != NULL; event = event->next) {
+            if (event->trig) {
+                event->trig = false;
+                event->callback(event->data);
+                num_callbacks++;
+                trig = true;
+            }
+        }
+    }
+    return num_callbacks;
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    static vivid_binding_data_t data;
+    static vivid_binding_t binding;
+    binding.data = &data;
+    binding.calloc = calloc_mem;
+    binding.free = free_mem;
+    binding.create_event = create_event;
+    binding.trigger_event = trigger_event;
+    binding.destroy_event = destroy_event;
+    binding.create_timer = create_timer;
+    binding.start_timer = start_timer;
+    binding.stop_timer = stop_timer;
+    binding.destroy_timer = destroy_timer;
+    binding.get_time = get_time;
+    binding.sleep = sleep_time;
+#if !VIVID_LOCKFREE
+    binding.create_mutex = create_mutex;
+    binding.lock_mutex = lock_mutex;
+    binding.unlock_mutex = unlock_mutex;
+    binding.destroy_mutex = destroy_mutex;
+#endif
+#if VIVID_LOG
+    binding.log = print_message;
+    binding.log_level = VIVID_LOG_LEVEL_WARN;
+#endif
+
+    benchmark_parallel(&binding);
+    benchmark_transitions(&binding);
+    benchmark_burst(&binding);
+#if VIVID_PARAM
+    benchmark_payload(&binding);
+#endif
+    benchmark_pipeline(&binding);
+    benchmark_jumps(&binding);
+    benchmark_dispatcher(&binding);
+    benchmark_instances(&binding);
+#if BENCHMARK_CONTENTION
+    benchmark_contention(&binding);
+#endif
+    return 0;
+}
@@ -0,0 +1,214 @@
+#include "benchmark.h"
+#include <stdio.h>
+#include <vivid/sm.h>
+
+// Dispatches an event handled only by the root state, and an event handled in every region, while
+// the number of parallel regions grows. The cost of the root event should not depend on the number
+// of regions, as they are pruned from the dispatch.
+
+#define MAX_REGIONS 64U
+
+typedef struct {
+    vivid_sm_t *vsm;
+    unsigned num_regions;
+    unsigned count;
+} parallel_t;
+
+VIVID_EVENT_PUBLIC(parallel_t, parallel, ev_root, vsm);
+VIVID_EVENT_PUBLIC(parallel_t, parallel, ev_region, vsm);
+
+#define REGION(n)                                                         \
+    VIVID_DECLARE_STATE(region_##n);                                      \
+    VIVID_DECLARE_STATE(region_##n##_idle);                               \
+    VIVID_DECLARE_STATE(region_##n##_busy);                               \
+    VIVID_STATE(parallel_t, region_##n)                                   \
+    {                                                                     \
+        VIVID_SUB_STATE(region_##n##_idle);                               \
+        VIVID_SUB_STATE(region_##n##_busy);                               \
+        VIVID_DEFAULT(region_##n##_idle, VIVID_NO_ACTION);                \
+    }                                                                     \
+    VIVID_STATE(parallel_t, region_##n##_idle)                            \
+    {                                                                     \
+        VIVID_ON_EVENT(ev_region, true, region_##n##_busy, me->count++;); \
+    }                                                                     \
+    VIVID_STATE(parallel_t, region_##n##_busy)                            \
+    {                                                                     \
+        VIVID_ON_EVENT(ev_region, true, region_##n##_idle, me->count++;); \
+    }
+
+#define SUB_REGION(n)                         \
+    if (me->num_regions > (n)) {              \
+        VIVID_SUB_STATE_PARALLEL(region_##n); \
+    }
+
+REGION(0)
+REGION(1)
+REGION(2)
+REGION(3)
+REGION(4)
+REGION(5)
+REGION(6)
+REGION(7)
+REGION(8)
+REGION(9)
+REGION(10)
+REGION(11)
+REGION(12)
+REGION(13)
+REGION(14)
+REGION(15)
+REGION(16)
+REGION(17)
+REGION(18)
+REGION(19)
+REGION(20)
+REGION(21)
+REGION(22)
+REGION(23)
+REGION(24)
+REGION(25)
+REGION(26)
+REGION(27)
+REGION(28)
+REGION(29)
+REGION(30)
+REGION(31)
+REGION(32)
+REGION(33)
+REGION(34)
+REGION(35)
+REGION(36)
+REGION(37)
+REGION(38)
+REGION(39)
+REGION(40)
+REGION(41)
+REGION(42)
+REGION(43)
+REGION(44)
+REGION(45)
+REGION(46)
+REGION(47)
+REGION(48)
+REGION(49)
+REGION(50)
+REGION(51)
+REGION(52)
+REGION(53)
+REGION(54)
+REGION(55)
+REGION(56)
+REGION(57)
+REGION(58)
+REGION(59)
+REGION(60)
+REGION(61)
+REGION(62)
+REGION(63)
+
+VIVID_DECLARE_STATE(root);
+VIVID_DECLARE_STATE(regions);
+
+VIVID_STATE(parallel_t, root)
+{
+    VIVID_SUB_STATE(regions);
+    VIVID_DEFAULT(regions, VIVID_NO_ACTION);
+    VIVID_ON_EVENT(ev_root, true, NULL, me->count++;);
+}
+
+VIVID_STATE(parallel_t, regions)
+{
+    SUB_REGION(0)
+    SUB_REGION(1)
+    SUB_REGION(2)
+    SUB_REGION(3)
+    SUB_REGION(4)
+    SUB_REGION(5)
+    SUB_REGION(6)
+    SUB_REGION(7)
+    SUB_REGION(8)
+    SUB_REGION(9)
+    SUB_REGION(10)
+    SUB_REGION(11)
+    SUB_REGION(12)
+    SUB_REGION(13)
+    SUB_REGION(14)
+    SUB_REGION(15)
+    SUB_REGION(16)
+    SUB_REGION(17)
+    SUB_REGION(18)
+    SUB_REGION(19)
+    SUB_REGION(20)
+    SUB_REGION(21)
+    SUB_REGION(22)
+    SUB_REGION(23)
+    SUB_REGION(24)
+    SUB_REGION(25)
+    SUB_REGION(26)
+    SUB_REGION(27)
+    SUB_REGION(28)
+    SUB_REGION(29)
+    SUB_REGION(30)
+    SUB_REGION(31)
+    SUB_REGION(32)
+    SUB_REGION(33)
+    SUB_REGION(34)
+    SUB_REGION(35)
+    SUB_REGION(36)
+    SUB_REGION(37)
+    SUB_REGION(38)
+    SUB_REGION(39)
+    SUB_REGION(40)
+    SUB_REGION(41)
+    SUB_REGION(42)
+    SUB_REGION(43)
+    SUB_REGION(44)
+    SUB_REGION(45)
+    SUB_REGION(46)
+    SUB_REGION(47)
+    SUB_REGION(48)
+    SUB_REGION(49)
+    SUB_REGION(50)
+    SUB_REGION(51)
+    SUB_REGION(52)
+    SUB_REGION(53)
+    SUB_REGION(54)
+    SUB_REGION(55)
+    SUB_REGION(56)
+    SUB_REGION(57)
+    SUB_REGION(58)
+    SUB_REGION(59)
+    SUB_REGION(60)
+    SUB_REGION(61)
+    SUB_REGION(62)
+    SUB_REGION(63)
+}
+
+static double measure(vivid_binding_t *binding, parallel_t *me, void (*event)(parallel_t *me))
+{
+    vivid_time_t start = binding->get_time(binding);
+    for (unsigned i = 0U; i < BENCHMARK_NUM_EVENTS; i++) {
+        event(me);
+        benchmark_run(binding);
+    }
+    return (binding->get_time(binding) - start) * 1e9 / BENCHMARK_NUM_EVENTS;
+}
+
+void benchmark_parallel(vivid_binding_t *binding)
+{
+    printf("parallel | regions | root event (ns) | region event (ns)\n");
+    for (unsigned num_regions = 1U; num_regions <= MAX_REGIONS; num_regions *= 2U) {
+        parallel_t me = { 0 };
+        me.num_regions = num_regions;
+        me.vsm = VIVID_CREATE_SM(binding, "parallel", root, 1U, &me);
+        if (me.vsm == NULL) {
+            printf("parallel | could not create state machine\n");
+            return;
+        }
+        benchmark_run(binding);
+        double root_time = measure(binding, &me, parallel_ev_root);
+        double region_time = measure(binding, &me, parallel_ev_region);
+        printf("parallel | %7u | %15.1f | %17.1f\n", num_regions, root_time, region_time);
+        vivid_destroy_sm(me.vsm);
+    }
+}
@@ -0,0 +1,124 @@
+#include "benchmark.h"
+#include <stdio.h>
+#include <string.h>
+#include <vivid/sm.h>
+
+#if VIVID_PARAM
+// Queues bursts of events with a large param, e.g. telemetry samples, once filled by the producer in
+// its own buffer and copied into the queue, and once filled in place with
+// VIVID_EVENT_PARAM_EMPLACE_PUBLIC(), for two sizes of param.
+
+#define BURST_SIZE 64U
+#define NUM_BURSTS 200U
+#define SMALL_SAMPLES 256U
+#define LARGE_SAMPLES 1024U
+
+typedef struct {
+    uint32_t samples[SMALL_SAMPLES];
+} small_telemetry_t;
+
+typedef struct {
+    uint32_t samples[LARGE_SAMPLES];
+} large_telemetry_t;
+
+typedef struct {
+    vivid_sm_t *vsm;
+    uint32_t sum;
+    unsigned count;
+} payload_t;
+
+VIVID_EVENT_PARAM_PUBLIC(payload_t, payload, ev_small, small_telemetry_t, vsm);
+VIVID_EVENT_PARAM_EMPLACE_PUBLIC(payload_t, payload, ev_small_emplaced, small_telemetry_t, vsm);
+VIVID_EVENT_PARAM_PUBLIC(payload_t, payload, ev_large, large_telemetry_t, vsm);
+VIVID_EVENT_PARAM_EMPLACE_PUBLIC(payload_t, payload, ev_large_emplaced, large_telemetry_t, vsm);
+
+static void fill(uint32_t *samples, unsigned num_samples, unsigned sequence)
+{
+    for (unsigned i = 0U; i < num_samples; i++) {
+        samples[i] = sequence + i;
+    }
+}
+
+static void handle(payload_t *me, const uint32_t *samples, unsigned num_samples)
+{
+    me->sum += samples[0] + samples[num_samples - 1U];
+    me->count++;
+}
+
+VIVID_DECLARE_STATE(root);
+
+VIVID_STATE(payload_t, root)
+{
+    VIVID_ON_EVENT_PARAM(ev_small, true, NULL, handle(me, param->samples, SMALL_SAMPLES););
+    VIVID_ON_EVENT_PARAM(ev_small_emplaced, true, NULL, handle(me, param->samples, SMALL_SAMPLES););
+    VIVID_ON_EVENT_PARAM(ev_large, true, NULL, handle(me, param->samples, LARGE_SAMPLES););
+    VIVID_ON_EVENT_PARAM(ev_large_emplaced, true, NULL, handle(me, param->samples, LARGE_SAMPLES););
+}
+
+static void queue_event(payload_t *me, bool large, bool emplaced, unsigned sequence)
+{
+    if (!emplaced) {
+        if (large) {
+            large_telemetry_t telemetry;
+            fill(telemetry.samples, LARGE_SAMPLES, sequence);
+            payload_ev_large(me, &telemetry);
+        } else {
+            small_telemetry_t telemetry;
+            fill(telemetry.samples, SMALL_SAMPLES, sequence);
+            payload_ev_small(me, &telemetry);
+        }
+        return;
+    }
+    vivid_event_reservation_t reservation;
+    if (large) {
+        large_telemetry_t *telemetry = payload_ev_large_emplaced_reserve(me, &reservation);
+        if (telemetry != NULL) {
+            fill(telemetry->samples, LARGE_SAMPLES, sequence);
+            payload_ev_large_emplaced_commit(me, &reservation);
+        }
+    } else {
+        small_telemetry_t *telemetry = payload_ev_small_emplaced_reserve(me, &reservation);
+        if (telemetry != NULL) {
+            fill(telemetry->samples, SMALL_SAMPLES, sequence);
+            payload_ev_small_emplaced_commit(me, &reservation);
+        }
+    }
+}
+
+static void run(vivid_binding_t *binding, payload_t *me, bool large, bool emplaced)
+{
+    me->sum = 0U;
+    me->count = 0U;
+    vivid_time_t start = binding->get_time(binding);
+    for (unsigned j = 0U; j < NUM_BURSTS; j++) {
+        for (unsigned k = 0U; k < BURST_SIZE; k++) {
+            queue_event(me, large, emplaced, k);
+        }
+        benchmark_run(binding);
+    }
+    double time = (binding->get_time(binding) - start) * 1e9 / (NUM_BURSTS * BURST_SIZE);
+    size_t param_size = large ? sizeof(large_telemetry_t) : sizeof(small_telemetry_t);
+    printf("payload | %9zu | %-8s | %10.1f\n", param_size, emplaced ? "emplaced" : "copied", time);
+    if ((me->count != (NUM_BURSTS * BURST_SIZE)) || (me->sum != (NUM_BURSTS * BURST_SIZE * ((large ? LARGE_SAMPLES : SMALL_SAMPLES) - 1U + (BURST_SIZE - 1U))))) {
+        printf("payload | unexpected params\n");
+    }
+}
+
+void benchmark_payload(vivid_binding_t *binding)
+{
+    payload_t me = { 0 };
+    me.vsm = VIVID_CREATE_SM(binding, "payload", root, BURST_SIZE, &me);
+    if (me.vsm == NULL) {
+        printf("payload | could not create state machine\n");
+        return;
+    }
+    vivid_set_event_budget(me.vsm, 0U, 0);
+    benchmark_run(binding);
+    printf("payload | param (B) | param    | event (ns)\n");
+    for (unsigned large = 0U; large < 2U; large++) {
+        run(binding, &me, large != 0U, false);
+        run(binding, &me, large != 0U, true);
+    }
+    vivid_destroy_sm(me.vsm);
+}
+#endif
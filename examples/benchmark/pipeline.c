@@ -0,0 +1,71 @@
+#include "benchmark.h"
+#include <stdio.h>
+#include <vivid/sm.h>
+
+// Passes events along a chain of state machines, queued or dispatched synchronously. The last
+// stage also raises an event to itself, which a synchronous dispatch handles after the current one.
+// Each callback stands for a wakeup of the binding, i.e. a system call on most real bindings.
+
+#define PIPELINE_NUM_STAGES 4U
+
+typedef struct stage {
+    vivid_sm_t *vsm;
+    struct stage *next;
+    unsigned count;
+    unsigned num_done;
+    unsigned num_nested;
+    bool in_action;
+} stage_t;
+
+VIVID_EVENT_PUBLIC(stage_t, stage, ev_queued, vsm);
+VIVID_EVENT_SYNC_PUBLIC(stage_t, stage, ev_sync, vsm);
+VIVID_EVENT_SYNC_PRIVATE(stage_t, ev_done, vsm);
+
+VIVID_DECLARE_STATE(root);
+
+VIVID_STATE(stage_t, root)
+{
+    VIVID_ON_EVENT(ev_queued, me->next != NULL, NULL, me->count++; stage_ev_queued(me->next););
+    VIVID_ON_EVENT(ev_queued, true, NULL, me->count++;);
+    VIVID_ON_EVENT(ev_sync, me->next != NULL, NULL, me->count++; stage_ev_sync(me->next););
+    VIVID_ON_EVENT(ev_sync, true, NULL, me->count++; me->in_action = true; ev_done(me); me->in_action = false;);
+    VIVID_ON_EVENT(ev_done, true, NULL, me->num_done++; me->num_nested += me->in_action ? 1U : 0U;);
+}
+
+void benchmark_pipeline(vivid_binding_t *binding)
+{
+    stage_t stages[PIPELINE_NUM_STAGES] = { 0 };
+    for (size_t i = 0U; i < PIPELINE_NUM_STAGES; i++) {
+        stages[i].next = (i + 1U < PIPELINE_NUM_STAGES) ? &stages[i + 1U] : NULL;
+        stages[i].vsm = VIVID_CREATE_SM(binding, "pipeline", root, 1U, &stages[i]);
+        if (stages[i].vsm == NULL) {
+            printf("pipeline | could not create state machine\n");
+            goto cleanup;
+        }
+    }
+    benchmark_run(binding);
+    printf("pipeline | stages | dispatch | item (ns) | callbacks per item\n");
+    for (unsigned sync = 0U; sync < 2U; sync++) {
+        size_t num_callbacks = 0U;
+        vivid_time_t start = binding->get_time(binding);
+        for (unsigned i = 0U; i < BENCHMARK_NUM_EVENTS; i++) {
+            if (sync) {
+                stage_ev_sync(&stages[0]);
+            } else {
+                stage_ev_queued(&stages[0]);
+            }
+            num_callbacks += benchmark_run(binding);
+        }
+        double time = (binding->get_time(binding) - start) * 1e9 / BENCHMARK_NUM_EVENTS;
+        printf("pipeline | %6u | %8s | %9.1f | %18.1f\n", PIPELINE_NUM_STAGES, sync ? "sync" : "queued", time, (double)num_callbacks / BENCHMARK_NUM_EVENTS);
+    }
+    const stage_t *last = &stages[PIPELINE_NUM_STAGES - 1U];
+    if ((stages[0].count != (2U * BENCHMARK_NUM_EVENTS)) || (last->count != (2U * BENCHMARK_NUM_EVENTS)) || (last->num_done != BENCHMARK_NUM_EVENTS) || (last->num_nested != 0U)) {
+        printf("pipeline | unexpected count\n");
+    }
+
+cleanup:
+    for (size_t i = 0U; i < PIPELINE_NUM_STAGES; i++) {
+        vivid_destroy_sm(stages[i].vsm);
+    }
+}
@@ -0,0 +1,88 @@
+#include "benchmark.h"
+#include <stdio.h>
+#include <vivid/sm.h>
+
+// Toggles between two nested timed states, and checks the resulting state after each event. Once
+// both transitions have fired, none of this should look up their target node.
+
+typedef struct {
+    vivid_sm_t *vsm;
+    unsigned count;
+} transitions_t;
+
+VIVID_EVENT_PUBLIC(transitions_t, transitions, ev_toggle, vsm);
+
+VIVID_DECLARE_STATE(root);
+VIVID_DECLARE_STATE(outer);
+VIVID_DECLARE_STATE(left);
+VIVID_DECLARE_STATE(left_inner);
+VIVID_DECLARE_STATE(right);
+VIVID_DECLARE_STATE(right_inner);
+
+VIVID_STATE(transitions_t, root)
+{
+    VIVID_SUB_STATE(outer);
+    VIVID_DEFAULT(outer, VIVID_NO_ACTION);
+}
+
+VIVID_STATE(transitions_t, outer)
+{
+    VIVID_SUB_STATE(left);
+    VIVID_SUB_STATE(right);
+    VIVID_DEFAULT(left, VIVID_NO_ACTION);
+}
+
+VIVID_STATE(transitions_t, left)
+{
+    VIVID_SUB_STATE(left_inner);
+    VIVID_DEFAULT(left_inner, VIVID_NO_ACTION);
+    VIVID_ON_TIMEOUT(tm_left, 10, true, right, VIVID_NO_ACTION);
+}
+
+VIVID_STATE(transitions_t, left_inner)
+{
+    VIVID_ON_EVENT(ev_toggle, true, right_inner, me->count++;);
+}
+
+VIVID_STATE(transitions_t, right)
+{
+    VIVID_SUB_STATE(right_inner);
+    VIVID_DEFAULT(right_inner, VIVID_NO_ACTION);
+    VIVID_ON_TIMEOUT(tm_right, 10, true, left, VIVID_NO_ACTION);
+}
+
+VIVID_STATE(transitions_t, right_inner)
+{
+    VIVID_ON_EVENT(ev_toggle, true, left_inner, me->count++;);
+}
+
+void benchmark_transitions(vivid_binding_t *binding)
+{
+    transitions_t me = { 0 };
+    me.vsm = VIVID_CREATE_SM(binding, "transitions", root, 1U, &me);
+    if (me.vsm == NULL) {
+        printf("transitions | could not create state machine\n");
+        return;
+    }
+    for (unsigned i = 0U; i < 2U; i++) {
+        transitions_ev_toggle(&me);
+        benchmark_run(binding);
+    }
+    me.count = 0U;
+    size_t num_lookups = vivid_get_num_node_lookups(me.vsm);
+    unsigned num_left = 0U;
+    vivid_time_t start = binding->get_time(binding);
+    for (unsigned i = 0U; i < BENCHMARK_NUM_EVENTS; i++) {
+        transitions_ev_toggle(&me);
+        benchmark_run(binding);
+        num_left += IS_IN(me.vsm, left_inner) ? 1U : 0U;
+    }
+    double time = (binding->get_time(binding) - start) * 1e9 / BENCHMARK_NUM_EVENTS;
+    num_lookups = vivid_get_num_node_lookups(me.vsm) - num_lookups;
+    printf("transitions | transition (ns) | node lookups\n");
+    printf("transitions | %15.1f | %12zu\n", time, num_lookups);
+    if ((me.count != BENCHMARK_NUM_EVENTS) || (num_left != (BENCHMARK_NUM_EVENTS / 2U))) {
+        printf("transitions | unexpected state\n");
+    }
+    vivid_destroy_sm(me.vsm);
+}
@@ -75,9 +75,9 @@ void callee_dispatch(callee_t *me, const char *caller_name, const callee_request
         return;
     }
     memcpy(new_request, request, sizeof(*request));
-    vivid_queue_push(me->dispatch_queue, caller_name, new_request, me->binding->free);
+    vivid_queue_push(me->dispatch_queue, VIVID_EVENT_ID_NONE, caller_name, new_request, me->binding->free);
 #else
-    vivid_queue_push(me->dispatch_queue, caller_name, request, sizeof(*request));
+    vivid_queue_push(me->dispatch_queue, VIVID_EVENT_ID_NONE, caller_name, request, sizeof(*request));
 #endif
     ev_dispatch(me);
 }
@@ -0,0 +1,84 @@
+#include "../application.h"
+#include <cstdio>
+#include <new>
+#include <vivid/sm.hpp>
+
+// The toaster example, written with the C++ front-end of vivid/sm.hpp.
+
+namespace {
+
+struct Toaster;
+
+struct off;
+struct on;
+struct root : vivid::composite<off, on> {
+};
+
+struct off {
+    static void on_entry(Toaster &)
+    {
+        std::printf("Toaster is off. Press enter to start!\n");
+    }
+};
+
+struct on {
+    static void on_entry(Toaster &)
+    {
+        std::printf("Toaster is on. Press enter to cancel, or wait for it to pop up...\n");
+    }
+};
+
+struct ev_button_press {
+};
+
+struct tm_popup {
+    static constexpr vivid_time_t timeout = 10.0;
+};
+
+void cancel(Toaster &, const ev_button_press &)
+{
+    std::printf("Toasting cancelled\n");
+}
+
+void pop_up(Toaster &, const tm_popup &)
+{
+    std::printf("Toast is ready!\n");
+}
+
+using transitions = vivid::list<
+    vivid::on_event<off, ev_button_press, on>,
+    vivid::on_event<on, ev_button_press, off, cancel>,
+    vivid::on_timeout<on, tm_popup, off, pop_up>>;
+
+struct Toaster {
+    Toaster(vivid_binding_t *binding)
+        : vsm(binding, *this)
+    {
+    }
+    vivid::sm<Toaster, root, transitions, 16U> vsm;
+};
+
+} // namespace
+
+void application_destroy(void *application)
+{
+    delete static_cast<Toaster *>(application);
+}
+
+void *application_create(vivid_binding_t *binding)
+{
+    Toaster *me = new (std::nothrow) Toaster(binding);
+    if ((me == nullptr) || !me->vsm.valid()) {
+        delete me;
+        return nullptr;
+    }
+    me->vsm.start();
+    return me;
+}
+
+void application_trigger(void *application, const char *value, size_t len)
+{
+    (void)value;
+    (void)len;
+    static_cast<Toaster *>(application)->vsm.post(ev_button_press {});
+}
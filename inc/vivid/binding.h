@@ -98,6 +98,7 @@ struct vivid_binding {
 #if VIVID_LOG
     void                   (*log          )(void *logger, vivid_log_level_t level, const char *message);
     void *logger;
+    vivid_log_level_t log_level; // Highest level logged, or VIVID_LOG_LEVEL_NONE (zero) for all levels
 #endif
 
     void                   (*error_hook   )(void *app, vivid_error_t error);
@@ -31,9 +31,32 @@ extern "C" {
 #define VIVID_UML_ARGS(...)
 #endif
 
+// Initializer of the vivid_event_t of the macros below, with all its fields so that they build
+// without warnings with -Wextra. The fields are designated in C only, as C++17 lacks designators:
+#ifdef __cplusplus
+#define VIVID_EVENT_INIT(name_text, coalesced, priority_lane, time_to_live) { name_text, VIVID_EVENT_ID_NONE, coalesced, priority_lane, time_to_live }
+#else
+#define VIVID_EVENT_INIT(name_text, coalesced, priority_lane, time_to_live) { .name = name_text, .id = VIVID_EVENT_ID_NONE, .coalesce = coalesced, .lane = priority_lane, .ttl = time_to_live }
+#endif
+
 #define VIVID_CREATE_SM(binding, name, root, event_queue_size, app) \
     vivid_create_sm(binding, state_##root, event_queue_size, app VIVID_LOG_ARGS(, name, #root))
 
+#define VIVID_CREATE_SM_WITH_LANES(binding, name, root, event_queue_size, num_lanes, app) \
+    vivid_create_sm_with_lanes(binding, state_##root, event_queue_size, num_lanes, app VIVID_LOG_ARGS(, name, #root))
+
+#define VIVID_CREATE_SM_CLASS(binding, name, root, app) \
+    vivid_create_sm_class(binding, state_##root, app VIVID_LOG_ARGS(, name, #root))
+
+#define VIVID_CREATE_SM_FROM_CLASS(binding, name, sm_class, event_queue_size, num_lanes, app) \
+    vivid_create_sm_from_class(binding, sm_class, event_queue_size, num_lanes, app VIVID_LOG_ARGS(, name))
+
+#define VIVID_CREATE_SM_FROM_TABLES(binding, name, root, event_queue_size, app) \
+    vivid_create_sm_from_tables(binding, /* Include the header generated by tools/vivid-gen.py -t before this macro */ &m_##root##_tables, event_queue_size, app VIVID_LOG_ARGS(, name))
+
+#define VIVID_CREATE_SM_CLASS_FROM_TABLES(binding, name, root, app) \
+    vivid_create_sm_class_from_tables(binding, /* Include the header generated by tools/vivid-gen.py -t before this macro */ &m_##root##_tables, app VIVID_LOG_ARGS(, name))
+
 #define VIVID_DECLARE_STATE(name) \
     static void state_##name(vivid_node_t *node, void *app)
 
@@ -96,39 +119,135 @@ extern "C" {
 #define VIVID_DECLARE_EVENT_CPP(name) void name()
 
 #define VIVID_EVENT_PUBLIC(type, module, name, vsm_member)                                                                                         \
-    static const char *const m_##name##_string = #name;                                                                                            \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, 0);                                                                 \
     void module##_##name(type *me)                                                                                                                 \
     {                                                                                                                                              \
-        vivid_queue_event(me->vsm_member, m_##name##_string VIVID_PARAM_ARGS(, NULL, VIVID_PARAM_STATIC_ARGS(0U) VIVID_PARAM_DYNAMIC_ARGS(NULL))); \
+        vivid_queue_event(me->vsm_member, &m_##name##_event VIVID_PARAM_ARGS(, NULL, VIVID_PARAM_STATIC_ARGS(0U) VIVID_PARAM_DYNAMIC_ARGS(NULL))); \
     }
 
 #define VIVID_EVENT_PRIVATE(type, name, vsm_member)                                                                                                \
-    static const char *const m_##name##_string = #name;                                                                                            \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, 0);                                                                 \
     static void name(type *me)                                                                                                                     \
     {                                                                                                                                              \
-        vivid_queue_event(me->vsm_member, m_##name##_string VIVID_PARAM_ARGS(, NULL, VIVID_PARAM_STATIC_ARGS(0U) VIVID_PARAM_DYNAMIC_ARGS(NULL))); \
+        vivid_queue_event(me->vsm_member, &m_##name##_event VIVID_PARAM_ARGS(, NULL, VIVID_PARAM_STATIC_ARGS(0U) VIVID_PARAM_DYNAMIC_ARGS(NULL))); \
     }
 
 #define VIVID_EVENT_CPP(module, name, vsm_member)                                                                                                    \
-    static const char *const m_##name##_string = #name;                                                                                              \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, 0);                                                                   \
+    void module::name()                                                                                                                              \
+    {                                                                                                                                                \
+        vivid_queue_event(this->vsm_member, &m_##name##_event VIVID_PARAM_ARGS(, NULL, VIVID_PARAM_STATIC_ARGS(0U) VIVID_PARAM_DYNAMIC_ARGS(NULL))); \
+    }
+
+// Same as the macros above, except that queuing the event has no effect while it is already queued
+// and not yet dispatched. Only for events handled by the state machine.
+#define VIVID_EVENT_COALESCED_PUBLIC(type, module, name, vsm_member)                                                                               \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, true, 0U, 0);                                                                  \
+    void module##_##name(type *me)                                                                                                                 \
+    {                                                                                                                                              \
+        vivid_queue_event(me->vsm_member, &m_##name##_event VIVID_PARAM_ARGS(, NULL, VIVID_PARAM_STATIC_ARGS(0U) VIVID_PARAM_DYNAMIC_ARGS(NULL))); \
+    }
+
+#define VIVID_EVENT_COALESCED_PRIVATE(type, name, vsm_member)                                                                                      \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, true, 0U, 0);                                                                  \
+    static void name(type *me)                                                                                                                     \
+    {                                                                                                                                              \
+        vivid_queue_event(me->vsm_member, &m_##name##_event VIVID_PARAM_ARGS(, NULL, VIVID_PARAM_STATIC_ARGS(0U) VIVID_PARAM_DYNAMIC_ARGS(NULL))); \
+    }
+
+#define VIVID_EVENT_COALESCED_CPP(module, name, vsm_member)                                                                                          \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, true, 0U, 0);                                                                    \
     void module::name()                                                                                                                              \
     {                                                                                                                                                \
-        vivid_queue_event(this->vsm_member, m_##name##_string VIVID_PARAM_ARGS(, NULL, VIVID_PARAM_STATIC_ARGS(0U) VIVID_PARAM_DYNAMIC_ARGS(NULL))); \
+        vivid_queue_event(this->vsm_member, &m_##name##_event VIVID_PARAM_ARGS(, NULL, VIVID_PARAM_STATIC_ARGS(0U) VIVID_PARAM_DYNAMIC_ARGS(NULL))); \
+    }
+
+// Same as VIVID_EVENT_PUBLIC(), VIVID_EVENT_PRIVATE() and VIVID_EVENT_CPP(), except that the event is
+// queued in the given priority lane, see vivid_create_sm_with_lanes().
+#define VIVID_EVENT_PRIORITY_PUBLIC(type, module, name, lane, vsm_member)                                                                          \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, lane, 0);                                                               \
+    void module##_##name(type *me)                                                                                                                 \
+    {                                                                                                                                              \
+        vivid_queue_event(me->vsm_member, &m_##name##_event VIVID_PARAM_ARGS(, NULL, VIVID_PARAM_STATIC_ARGS(0U) VIVID_PARAM_DYNAMIC_ARGS(NULL))); \
+    }
+
+#define VIVID_EVENT_PRIORITY_PRIVATE(type, name, lane, vsm_member)                                                                                 \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, lane, 0);                                                               \
+    static void name(type *me)                                                                                                                     \
+    {                                                                                                                                              \
+        vivid_queue_event(me->vsm_member, &m_##name##_event VIVID_PARAM_ARGS(, NULL, VIVID_PARAM_STATIC_ARGS(0U) VIVID_PARAM_DYNAMIC_ARGS(NULL))); \
+    }
+
+#define VIVID_EVENT_PRIORITY_CPP(module, name, lane, vsm_member)                                                                                     \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, lane, 0);                                                                 \
+    void module::name()                                                                                                                              \
+    {                                                                                                                                                \
+        vivid_queue_event(this->vsm_member, &m_##name##_event VIVID_PARAM_ARGS(, NULL, VIVID_PARAM_STATIC_ARGS(0U) VIVID_PARAM_DYNAMIC_ARGS(NULL))); \
+    }
+
+// Same as VIVID_EVENT_PUBLIC(), VIVID_EVENT_PRIVATE() and VIVID_EVENT_CPP(), except that the event is
+// dropped instead of dispatched once queued for longer than ttl, e.g. for a heartbeat reply that is
+// useless once late, see vivid_get_num_expired_events().
+#define VIVID_EVENT_TTL_PUBLIC(type, module, name, ttl, vsm_member)                                                                                \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, VIVID_CONVERT_TIME(ttl));                                           \
+    void module##_##name(type *me)                                                                                                                 \
+    {                                                                                                                                              \
+        vivid_queue_event(me->vsm_member, &m_##name##_event VIVID_PARAM_ARGS(, NULL, VIVID_PARAM_STATIC_ARGS(0U) VIVID_PARAM_DYNAMIC_ARGS(NULL))); \
+    }
+
+#define VIVID_EVENT_TTL_PRIVATE(type, name, ttl, vsm_member)                                                                                       \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, VIVID_CONVERT_TIME(ttl));                                           \
+    static void name(type *me)                                                                                                                     \
+    {                                                                                                                                              \
+        vivid_queue_event(me->vsm_member, &m_##name##_event VIVID_PARAM_ARGS(, NULL, VIVID_PARAM_STATIC_ARGS(0U) VIVID_PARAM_DYNAMIC_ARGS(NULL))); \
+    }
+
+#define VIVID_EVENT_TTL_CPP(module, name, ttl, vsm_member)                                                                                           \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, VIVID_CONVERT_TIME(ttl));                                             \
+    void module::name()                                                                                                                              \
+    {                                                                                                                                                \
+        vivid_queue_event(this->vsm_member, &m_##name##_event VIVID_PARAM_ARGS(, NULL, VIVID_PARAM_STATIC_ARGS(0U) VIVID_PARAM_DYNAMIC_ARGS(NULL))); \
+    }
+
+// Same as VIVID_EVENT_PUBLIC(), VIVID_EVENT_PRIVATE() and VIVID_EVENT_CPP(), except that the event is
+// handled synchronously, see vivid_dispatch_event().
+#define VIVID_EVENT_SYNC_PUBLIC(type, module, name, vsm_member)                                                                                       \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, 0);                                                                    \
+    void module##_##name(type *me)                                                                                                                    \
+    {                                                                                                                                                 \
+        vivid_dispatch_event(me->vsm_member, &m_##name##_event VIVID_PARAM_ARGS(, NULL, VIVID_PARAM_STATIC_ARGS(0U) VIVID_PARAM_DYNAMIC_ARGS(NULL))); \
+    }
+
+#define VIVID_EVENT_SYNC_PRIVATE(type, name, vsm_member)                                                                                              \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, 0);                                                                    \
+    static void name(type *me)                                                                                                                        \
+    {                                                                                                                                                 \
+        vivid_dispatch_event(me->vsm_member, &m_##name##_event VIVID_PARAM_ARGS(, NULL, VIVID_PARAM_STATIC_ARGS(0U) VIVID_PARAM_DYNAMIC_ARGS(NULL))); \
+    }
+
+#define VIVID_EVENT_SYNC_CPP(module, name, vsm_member)                                                                                                  \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, 0);                                                                      \
+    void module::name()                                                                                                                                 \
+    {                                                                                                                                                   \
+        vivid_dispatch_event(this->vsm_member, &m_##name##_event VIVID_PARAM_ARGS(, NULL, VIVID_PARAM_STATIC_ARGS(0U) VIVID_PARAM_DYNAMIC_ARGS(NULL))); \
     }
 
 #define VIVID_ON_EVENT(name, guard, target_state, action, /* json_props */...)                                                                                                   \
     if (vivid_on_event(node, /* Use VIVID_EVENT_PUBLIC(), VIVID_EVENT_PRIVATE() or VIVID_EVENT_CPP() before this macro */                                                        \
-            m_##name##_string VIVID_PARAM_ARGS(, NULL VIVID_PARAM_STATIC_ARGS(, 0U)) VIVID_UML_ARGS(, state_##target_state, #guard, #target_state, #action, "" #__VA_ARGS__))) { \
-        if (vivid_transit(node, guard, state_##target_state VIVID_LOG_ARGS(, "event", m_##name##_string, #guard, #target_state))) {                                              \
+            &m_##name##_event VIVID_PARAM_ARGS(, NULL VIVID_PARAM_STATIC_ARGS(, 0U)) VIVID_UML_ARGS(, state_##target_state, #guard, #target_state, #action, "" #__VA_ARGS__))) { \
+        if (vivid_transit(node, guard, state_##target_state VIVID_LOG_ARGS(, "event", #name, #guard, #target_state))) {                                                          \
             action return;                                                                                                                                                       \
         }                                                                                                                                                                        \
     }
 
-#define VIVID_ON_TIMEOUT(name, timeout, guard, target_state, action, /* json_props */...)                                                                               \
-    if (vivid_on_timeout(node, #name, VIVID_CONVERT_TIME(timeout) VIVID_UML_ARGS(, state_##target_state, #timeout, #guard, #target_state, #action, "" #__VA_ARGS__))) { \
-        if (vivid_transit(node, guard, state_##target_state VIVID_LOG_ARGS(, "timer", #name, #guard, #target_state))) {                                                 \
-            action return;                                                                                                                                              \
-        }                                                                                                                                                               \
+#define VIVID_ON_TIMEOUT(name, timeout, guard, target_state, action, /* json_props */...)                                                                                               \
+    {                                                                                                                                                                                   \
+        static vivid_event_t m_##name##_timer = VIVID_EVENT_INIT(#name, false, 0U, 0);                                                                                                  \
+        if (vivid_on_timeout(node, &m_##name##_timer, VIVID_CONVERT_TIME(timeout) VIVID_UML_ARGS(, state_##target_state, #timeout, #guard, #target_state, #action, "" #__VA_ARGS__))) { \
+            if (vivid_transit(node, guard, state_##target_state VIVID_LOG_ARGS(, "timer", #name, #guard, #target_state))) {                                                             \
+                action return;                                                                                                                                                          \
+            }                                                                                                                                                                           \
+        }                                                                                                                                                                               \
     }
 
 #define VIVID_JUMP(guard, target_state, action, /* json_props */...)                                                                               \
@@ -143,10 +262,18 @@ extern "C" {
 
 #define VIVID_DECLARE_EVENT_PARAM_CPP(name, param_type) void name(const param_type &param)
 
+#define VIVID_DECLARE_EVENT_PARAM_EMPLACE_PUBLIC(type, module, name, param_type)             \
+    param_type *module##_##name##_reserve(type *me, vivid_event_reservation_t *reservation); \
+    void module##_##name##_commit(type *me, vivid_event_reservation_t *reservation)
+
+#define VIVID_DECLARE_EVENT_PARAM_EMPLACE_CPP(name, param_type)         \
+    param_type *name##_reserve(vivid_event_reservation_t &reservation); \
+    void name##_commit(vivid_event_reservation_t &reservation)
+
 #if VIVID_PARAM_DYNAMIC
 #define VIVID_EVENT_PARAM_PUBLIC(type, module, name, param_type, vsm_member)            \
     typedef param_type name##_param_type_t;                                             \
-    static const char *const m_##name##_string = #name;                                 \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, 0);      \
     void module##_##name(type *me, const param_type *param)                             \
     {                                                                                   \
         vivid_binding_t *binding = vivid_get_binding(me->vsm_member);                   \
@@ -155,12 +282,12 @@ extern "C" {
             return;                                                                     \
         }                                                                               \
         memcpy(new_param, param, sizeof(*param));                                       \
-        vivid_queue_event(me->vsm_member, m_##name##_string, new_param, binding->free); \
+        vivid_queue_event(me->vsm_member, &m_##name##_event, new_param, binding->free); \
     }
 
 #define VIVID_EVENT_PARAM_PRIVATE(type, name, param_type, vsm_member)                   \
     typedef param_type name##_param_type_t;                                             \
-    static const char *const m_##name##_string = #name;                                 \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, 0);      \
     static void name(type *me, param_type *param)                                       \
     {                                                                                   \
         vivid_binding_t *binding = vivid_get_binding(me->vsm_member);                   \
@@ -169,12 +296,12 @@ extern "C" {
             return;                                                                     \
         }                                                                               \
         memcpy(new_param, param, sizeof(*param));                                       \
-        vivid_queue_event(me->vsm_member, m_##name##_string, new_param, binding->free); \
+        vivid_queue_event(me->vsm_member, &m_##name##_event, new_param, binding->free); \
     }
 
 #define VIVID_EVENT_PARAM_CPP(module, name, param_type, vsm_member)                              \
     typedef param_type name##_param_type_t;                                                      \
-    static const char *const m_##name##_string = #name;                                          \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, 0);               \
     static void destroy_param_##name(void *param)                                                \
     {                                                                                            \
         param_type *old_param = (param_type *)param;                                             \
@@ -183,39 +310,145 @@ extern "C" {
     void module::name(const param_type &param)                                                   \
     {                                                                                            \
         void *new_param = new param_type(param);                                                 \
-        vivid_queue_event(this->vsm_member, m_##name##_string, new_param, destroy_param_##name); \
+        vivid_queue_event(this->vsm_member, &m_##name##_event, new_param, destroy_param_##name); \
+    }
+
+#define VIVID_EVENT_PARAM_TTL_PUBLIC(type, module, name, param_type, ttl, vsm_member)                    \
+    typedef param_type name##_param_type_t;                                                              \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, VIVID_CONVERT_TIME(ttl)); \
+    void module##_##name(type *me, const param_type *param)                                              \
+    {                                                                                                    \
+        vivid_binding_t *binding = vivid_get_binding(me->vsm_member);                                    \
+        void *new_param = binding->calloc(binding, 1U, sizeof(*param));                                  \
+        if (new_param == NULL) {                                                                         \
+            return;                                                                                      \
+        }                                                                                                \
+        memcpy(new_param, param, sizeof(*param));                                                        \
+        vivid_queue_event(me->vsm_member, &m_##name##_event, new_param, binding->free);                  \
+    }
+
+#define VIVID_EVENT_PARAM_TTL_PRIVATE(type, name, param_type, ttl, vsm_member)                           \
+    typedef param_type name##_param_type_t;                                                              \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, VIVID_CONVERT_TIME(ttl)); \
+    static void name(type *me, param_type *param)                                                        \
+    {                                                                                                    \
+        vivid_binding_t *binding = vivid_get_binding(me->vsm_member);                                    \
+        void *new_param = binding->calloc(binding, 1U, sizeof(*param));                                  \
+        if (new_param == NULL) {                                                                         \
+            return;                                                                                      \
+        }                                                                                                \
+        memcpy(new_param, param, sizeof(*param));                                                        \
+        vivid_queue_event(me->vsm_member, &m_##name##_event, new_param, binding->free);                  \
+    }
+
+#define VIVID_EVENT_PARAM_TTL_CPP(module, name, param_type, ttl, vsm_member)                             \
+    typedef param_type name##_param_type_t;                                                              \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, VIVID_CONVERT_TIME(ttl)); \
+    static void destroy_param_##name(void *param)                                                        \
+    {                                                                                                    \
+        param_type *old_param = (param_type *)param;                                                     \
+        delete old_param;                                                                                \
+    }                                                                                                    \
+    void module::name(const param_type &param)                                                           \
+    {                                                                                                    \
+        void *new_param = new param_type(param);                                                         \
+        vivid_queue_event(this->vsm_member, &m_##name##_event, new_param, destroy_param_##name);         \
     }
 #else
 #define VIVID_EVENT_PARAM_PUBLIC(type, module, name, param_type, vsm_member)             \
     typedef param_type name##_param_type_t;                                              \
-    static const char *const m_##name##_string = #name;                                  \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, 0);       \
     void module##_##name(type *me, const param_type *param)                              \
     {                                                                                    \
-        vivid_queue_event(me->vsm_member, m_##name##_string, param, sizeof(param_type)); \
+        vivid_queue_event(me->vsm_member, &m_##name##_event, param, sizeof(param_type)); \
     }
 
 #define VIVID_EVENT_PARAM_PRIVATE(type, name, param_type, vsm_member)                    \
     typedef param_type name##_param_type_t;                                              \
-    static const char *const m_##name##_string = #name;                                  \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, 0);       \
     static void name(type *me, const param_type *param)                                  \
     {                                                                                    \
-        vivid_queue_event(me->vsm_member, m_##name##_string, param, sizeof(param_type)); \
+        vivid_queue_event(me->vsm_member, &m_##name##_event, param, sizeof(param_type)); \
     }
 
 #define VIVID_EVENT_PARAM_CPP(module, name, param_type, vsm_member)                         \
     typedef param_type name##_param_type_t;                                                 \
-    static const char *const m_##name##_string = #name;                                     \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, 0);          \
     void module::name(const param_type &param)                                              \
     {                                                                                       \
-        vivid_queue_event(this->vsm_member, m_##name##_string, &param, sizeof(param_type)); \
+        vivid_queue_event(this->vsm_member, &m_##name##_event, &param, sizeof(param_type)); \
+    }
+
+#define VIVID_EVENT_PARAM_TTL_PUBLIC(type, module, name, param_type, ttl, vsm_member)                    \
+    typedef param_type name##_param_type_t;                                                              \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, VIVID_CONVERT_TIME(ttl)); \
+    void module##_##name(type *me, const param_type *param)                                              \
+    {                                                                                                    \
+        vivid_queue_event(me->vsm_member, &m_##name##_event, param, sizeof(param_type));                 \
+    }
+
+#define VIVID_EVENT_PARAM_TTL_PRIVATE(type, name, param_type, ttl, vsm_member)                           \
+    typedef param_type name##_param_type_t;                                                              \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, VIVID_CONVERT_TIME(ttl)); \
+    static void name(type *me, const param_type *param)                                                  \
+    {                                                                                                    \
+        vivid_queue_event(me->vsm_member, &m_##name##_event, param, sizeof(param_type));                 \
+    }
+
+#define VIVID_EVENT_PARAM_TTL_CPP(module, name, param_type, ttl, vsm_member)                             \
+    typedef param_type name##_param_type_t;                                                              \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, VIVID_CONVERT_TIME(ttl)); \
+    void module::name(const param_type &param)                                                           \
+    {                                                                                                    \
+        vivid_queue_event(this->vsm_member, &m_##name##_event, &param, sizeof(param_type));              \
     }
 #endif
 
+// Same as VIVID_EVENT_PARAM_PUBLIC(), VIVID_EVENT_PARAM_PRIVATE() and VIVID_EVENT_PARAM_CPP(), except
+// that the param is filled in place instead of being copied, between <name>_reserve(), which returns
+// NULL if the event is not queued, and <name>_commit(), see vivid_reserve_event(). The param type
+// must be trivially copyable, as it is not constructed.
+#define VIVID_EVENT_PARAM_EMPLACE_PUBLIC(type, module, name, param_type, vsm_member)                                  \
+    typedef param_type name##_param_type_t;                                                                           \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, 0);                                    \
+    param_type *module##_##name##_reserve(type *me, vivid_event_reservation_t *reservation)                           \
+    {                                                                                                                 \
+        return (param_type *)vivid_reserve_event(me->vsm_member, &m_##name##_event, sizeof(param_type), reservation); \
+    }                                                                                                                 \
+    void module##_##name##_commit(type *me, vivid_event_reservation_t *reservation)                                   \
+    {                                                                                                                 \
+        vivid_commit_event(me->vsm_member, &m_##name##_event, reservation);                                           \
+    }
+
+#define VIVID_EVENT_PARAM_EMPLACE_PRIVATE(type, name, param_type, vsm_member)                                         \
+    typedef param_type name##_param_type_t;                                                                           \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, 0);                                    \
+    static param_type *name##_reserve(type *me, vivid_event_reservation_t *reservation)                               \
+    {                                                                                                                 \
+        return (param_type *)vivid_reserve_event(me->vsm_member, &m_##name##_event, sizeof(param_type), reservation); \
+    }                                                                                                                 \
+    static void name##_commit(type *me, vivid_event_reservation_t *reservation)                                       \
+    {                                                                                                                 \
+        vivid_commit_event(me->vsm_member, &m_##name##_event, reservation);                                           \
+    }
+
+#define VIVID_EVENT_PARAM_EMPLACE_CPP(module, name, param_type, vsm_member)                                                           \
+    typedef param_type name##_param_type_t;                                                                                           \
+    static vivid_event_t m_##name##_event = VIVID_EVENT_INIT(#name, false, 0U, 0);                                                    \
+    param_type *module::name##_reserve(vivid_event_reservation_t &reservation)                                                        \
+    {                                                                                                                                 \
+        return static_cast<param_type *>(vivid_reserve_event(this->vsm_member, &m_##name##_event, sizeof(param_type), &reservation)); \
+    }                                                                                                                                 \
+    void module::name##_commit(vivid_event_reservation_t &reservation)                                                                \
+    {                                                                                                                                 \
+        vivid_commit_event(this->vsm_member, &m_##name##_event, &reservation);                                                        \
+    }
+
 #define VIVID_ON_EVENT_PARAM(name, guard, target_state, action, /* json_props */...)                                                                                                                                         \
     {                                                                                                                                                                                                                        \
         /* Use VIVID_EVENT_PARAM_PUBLIC(), VIVID_EVENT_PARAM_PRIVATE() or VIVID_EVENT_PARAM_CPP() before this macro */ const name##_param_type_t *param;                                                                     \
-        if (vivid_on_event(node, m_##name##_string, (const void **)&param VIVID_PARAM_STATIC_ARGS(, sizeof(name##_param_type_t)) VIVID_UML_ARGS(, state_##target_state, #guard, #target_state, #action, "" #__VA_ARGS__))) { \
-            if (vivid_transit(node, guard, state_##target_state VIVID_LOG_ARGS(, "event", m_##name##_string, #guard, #target_state))) {                                                                                      \
+        if (vivid_on_event(node, &m_##name##_event, (const void **)&param VIVID_PARAM_STATIC_ARGS(, sizeof(name##_param_type_t)) VIVID_UML_ARGS(, state_##target_state, #guard, #target_state, #action, "" #__VA_ARGS__))) { \
+            if (vivid_transit(node, guard, state_##target_state VIVID_LOG_ARGS(, "event", #name, #guard, #target_state))) {                                                                                                  \
                 action return;                                                                                                                                                                                               \
             }                                                                                                                                                                                                                \
         }                                                                                                                                                                                                                    \
@@ -224,7 +457,7 @@ extern "C" {
 #define VIVID_JUMP_PARAM(event_name, guard, target_state, action, /* json_props */...)                                                                                  \
     {                                                                                                                                                                   \
         /* Use VIVID_EVENT_PARAM_PUBLIC(), VIVID_EVENT_PARAM_PRIVATE() or VIVID_EVENT_PARAM_CPP() before this macro */ const event_name##_param_type_t *param;          \
-        if (vivid_jump(node, (const void **)&param, m_##event_name##_string VIVID_UML_ARGS(, state_##target_state, #guard, #target_state, #action, "" #__VA_ARGS__))) { \
+        if (vivid_jump(node, (const void **)&param, &m_##event_name##_event VIVID_UML_ARGS(, state_##target_state, #guard, #target_state, #action, "" #__VA_ARGS__))) { \
             if (vivid_transit(node, guard, state_##target_state VIVID_LOG_ARGS(, "jump", "", #guard, #target_state))) {                                                 \
                 action return;                                                                                                                                          \
             }                                                                                                                                                           \
@@ -232,6 +465,8 @@ extern "C" {
     }
 #endif
 
+#define VIVID_NUM_EXPIRED_EVENTS(vsm, name) vivid_get_num_expired_events(vsm, /* Use VIVID_EVENT_TTL_*() or VIVID_EVENT_PARAM_TTL_*() before this macro */ &m_##name##_event)
+
 #define IS_IN(vsm, state) vivid_is_in(vsm, /* Use VIVID_DECLARE_STATE() or VIVID_DECLARE_STATE_CPP() before this macro */ state_##state)
 
 #define VIVID_DECLARE_IS_IN_PUBLIC(type, module, state) bool module##_is_in_##state(type *me)
@@ -249,8 +484,22 @@ extern "C" {
 #define VIVID_NO_ACTION
 
 typedef struct vivid_sm vivid_sm_t;
+typedef struct vivid_sm_class vivid_sm_class_t;
 typedef struct vivid_node vivid_node_t;
 
+// Events are identified by a small integer id, which is assigned by the first vivid_create_sm() or
+// vivid_create_sm_class() call for a state machine that handles the event. The name is only used
+// for logging.
+// Note: state machines and classes should be created from one thread at a time, as id assignment
+// is not locked.
+typedef struct {
+    const char *name;
+    vivid_event_id_t id;
+    bool coalesce; // Set by VIVID_EVENT_COALESCED_*(), to absorb the event while it is already queued
+    uint8_t lane; // Set by VIVID_EVENT_PRIORITY_*(), 0 being the lowest priority
+    vivid_time_t ttl; // Set by VIVID_EVENT_TTL_*() and VIVID_EVENT_PARAM_TTL_*(), 0 for none
+} vivid_event_t;
+
 typedef enum {
     VIVID_NODE_TYPE_ROOT,
     VIVID_NODE_TYPE_STATE,
@@ -262,15 +511,160 @@ typedef enum {
 
 typedef void (*vivid_state_t)(vivid_node_t *node, void *app);
 typedef void (*vivid_state_change_callback_t)(void *app);
+typedef void (*vivid_watermark_callback_t)(void *app, bool high);
+
+// What happens to an event queued while its queue is full, see vivid_set_overload_policy():
+typedef enum {
+    VIVID_OVERLOAD_REJECT_NEWEST, // The event is lost
+    VIVID_OVERLOAD_DROP_OLDEST, // The oldest event queued after the one being handled is lost instead
+    VIVID_OVERLOAD_REPLACE_SAME, // The last event of the same id queued is replaced, otherwise the event is lost
+    VIVID_OVERLOAD_BLOCK // The producer sleeps until the event is queued, or the timeout expires and it is lost
+} vivid_overload_policy_t;
+
+#if VIVID_PARAM
+// Event reserved by vivid_reserve_event(), until committed by vivid_commit_event():
+typedef struct {
+#if VIVID_PARAM_DYNAMIC
+    void *param;
+#else
+    vivid_queue_t *queue;
+    vivid_queue_reservation_t queue_reservation;
+#endif
+} vivid_event_reservation_t;
+#endif
+
+// Nodes are stored in one array per state machine, in depth-first order starting with the root,
+// and are linked by their index in this array:
+typedef uint16_t vivid_node_index_t;
+#define VIVID_NODE_INDEX_NONE UINT16_MAX
+
+// Topology of a node, recorded by walking the state functions, or generated by tools/vivid-gen.py:
+typedef struct {
+    vivid_state_t fn;
+    vivid_node_index_t parent;
+    vivid_node_index_t children; // Last sub-state, the others following through siblings
+    vivid_node_index_t siblings;
+    vivid_node_index_t default_child;
+    vivid_node_index_t depth;
+    vivid_node_index_t subtree_end; // Index following the last descendant
+    vivid_node_type_t type;
+    bool parallel_children;
+#if VIVID_LOG
+    const char *name;
+#endif
+#if VIVID_UML
+    const char *json_props;
+#endif
+} vivid_node_info_t;
+
+// Events handled by a node, generated by tools/vivid-gen.py:
+typedef struct {
+    vivid_event_t *const *events; // NULL-terminated
+    bool jumps;
+    bool timers; // The timer events are local to the state function, so it is called to record them
+} vivid_node_handlers_t;
+
+// Dispatcher generated by tools/vivid-gen.py -d, which handles an event in a node by expanding the
+// handlers of this event only, instead of calling the state function. The events are numbered by
+// their position in the events of the tables.
+typedef void (*vivid_dispatch_t)(vivid_node_t *node, void *app, size_t node_index, size_t event_index);
+
+// Tables generated by tools/vivid-gen.py for a state machine, see vivid_create_sm_class_from_tables():
+typedef struct {
+    const vivid_node_info_t *nodes;
+    const vivid_node_handlers_t *handlers; // One per node
+    size_t num_nodes;
+    vivid_event_t *const *events; // All the events of the state machine, NULL-terminated
+    vivid_dispatch_t dispatch; // NULL if not generated, ignored if VIVID_DISPATCH is disabled
+#if VIVID_PARAM_STATIC
+    size_t max_param_size;
+#endif
+} vivid_sm_tables_t;
 
 vivid_sm_t *vivid_create_sm(vivid_binding_t *binding, vivid_state_t root_fn, size_t event_queue_size, void *app VIVID_LOG_ARGS(, const char *name, const char *root_name));
 
+// Same as vivid_create_sm(), with num_lanes event queues of event_queue_size entries each. The events
+// of higher lanes are always dispatched first, and the events of a lane in the order queued. Events
+// of lanes above the last one are queued in the last one.
+vivid_sm_t *vivid_create_sm_with_lanes(vivid_binding_t *binding, vivid_state_t root_fn, size_t event_queue_size, size_t num_lanes, void *app VIVID_LOG_ARGS(, const char *name, const char *root_name));
+
+// Records the topology of a state machine once, to create any number of instances of it with
+// vivid_create_sm_from_class(). The state functions are called with app while recording, e.g. to
+// evaluate the timeouts, so it should be an application object of the right type, or NULL if
+// they do not need one. The class is read-only from then on, and must outlive its instances.
+vivid_sm_class_t *vivid_create_sm_class(vivid_binding_t *binding, vivid_state_t root_fn, void *app VIVID_LOG_ARGS(, const char *name, const char *root_name));
+
+// Same as vivid_create_sm_class(), except that the topology is taken from tables generated by
+// tools/vivid-gen.py, which may be placed in read-only memory. Only the state functions with
+// timeouts are called, to record their timers. The tables must be generated again whenever the
+// state functions change, and must outlive the class.
+vivid_sm_class_t *vivid_create_sm_class_from_tables(vivid_binding_t *binding, const vivid_sm_tables_t *tables, void *app VIVID_LOG_ARGS(, const char *name));
+
+void vivid_destroy_sm_class(vivid_sm_class_t *me);
+
+// Same as vivid_create_sm_with_lanes(), except that the topology is taken from the class, so that
+// the instance only holds its own state, timers and queues. The instances created on the binding of
+// the class share its log buffer, so they should be used from the same thread.
+vivid_sm_t *vivid_create_sm_from_class(vivid_binding_t *binding, vivid_sm_class_t *sm_class, size_t event_queue_size, size_t num_lanes, void *app VIVID_LOG_ARGS(, const char *name));
+
+// Same as vivid_create_sm(), with a class created by vivid_create_sm_class_from_tables().
+vivid_sm_t *vivid_create_sm_from_tables(vivid_binding_t *binding, const vivid_sm_tables_t *tables, size_t event_queue_size, void *app VIVID_LOG_ARGS(, const char *name));
+
 void vivid_destroy_sm(vivid_sm_t *me);
 
 vivid_binding_t *vivid_get_binding(vivid_sm_t *me);
 
+// Number of lookups of transition targets by state function so far. Each transition looks up its
+// target at its first firing only, so this stays constant once all transitions have fired.
+size_t vivid_get_num_node_lookups(vivid_sm_t *me);
+
 void vivid_set_state_change_callback(vivid_sm_t *me, vivid_state_change_callback_t callback);
 
+// Limits the events handled per wakeup of the binding event, by count and/or by time (0 for no
+// limit). Each event still runs to completion, so the time limit may be exceeded by one event.
+// The remaining events are handled at the next wakeup. Defaults to VIVID_EVENT_BUDGET events.
+void vivid_set_event_budget(vivid_sm_t *me, size_t max_events, vivid_time_t max_time);
+
+// Declares that the events of the lane are only ever queued by one thread, e.g. a socket reader, so
+// that they are queued without any compare and swap with VIVID_LOCKFREE, see
+// vivid_queue_create_with_producers(). The timeouts are queued by the timer thread of the binding,
+// so they should be handled in another lane. Must be called before any event of the lane is queued.
+bool vivid_set_single_producer(vivid_sm_t *me, size_t lane);
+
+// Lets the event queues grow once full, with segments of the pool, e.g. shared by the state machines
+// of a binding, up to max_bytes held by the state machine, 0 for no limit besides the one of the
+// pool, see vivid_queue_create_pool(). Must be called before any event is queued, and the pool must
+// outlive the state machine. Fails if the segments of the pool cannot hold the params of its events.
+bool vivid_set_queue_pool(vivid_sm_t *me, vivid_queue_pool_t *pool, size_t max_bytes);
+
+#if VIVID_PARAM_STATIC
+// Largest param of the events of the state machine, which the pools given to vivid_set_queue_pool()
+// must hold, i.e. the smallest max_param_size of vivid_queue_create_pool():
+size_t vivid_get_max_param_size(vivid_sm_t *me);
+#endif
+
+// Sets what happens to the events queued while their queue is full, VIVID_OVERLOAD_REJECT_NEWEST by
+// default. VIVID_OVERLOAD_DROP_OLDEST and VIVID_OVERLOAD_REPLACE_SAME are not available with
+// VIVID_LOCKFREE, see vivid_queue_push_replacing(). With VIVID_OVERLOAD_BLOCK, the producers sleep
+// for up to block_timeout, including the timer thread of the binding for the timeouts, and the
+// thread of the state machine for the events it queues itself, which cannot be handled meanwhile.
+// The events lost and dropped are reported at most once per VIVID_OVERLOAD_REPORT_TIME, along with
+// the error hook for the events lost. Without a logger nor an error hook, they are only counted.
+bool vivid_set_overload_policy(vivid_sm_t *me, vivid_overload_policy_t policy, vivid_time_t block_timeout);
+
+// Calls back once the events queued reach high, and again once they fall back to low, e.g. to slow
+// down the producers before the events are lost. The high call is made by the producer, and the low
+// call by the thread of the state machine. Must be called before any event is queued.
+void vivid_set_watermarks(vivid_sm_t *me, size_t high, size_t low, vivid_watermark_callback_t callback);
+
+// Number of events lost or dropped as their queue was full:
+size_t vivid_get_num_dropped_events(vivid_sm_t *me);
+
+// Number of events of the given kind, or of any kind if NULL, dropped by the state machine instead of
+// being dispatched as their deadline had passed, see vivid_queue_event_with_deadline().
+// Note: this should be called from the thread handling the events.
+size_t vivid_get_num_expired_events(vivid_sm_t *me, const vivid_event_t *event);
+
 void vivid_sub_node(vivid_node_t *node, vivid_state_t fn, vivid_node_type_t type VIVID_LOG_ARGS(, const char *name VIVID_UML_ARGS(, const char *json_props)));
 
 bool vivid_default(vivid_node_t *node, vivid_state_t fn VIVID_LOG_ARGS(, const char *name VIVID_UML_ARGS(, const char *action_text, const char *json_props)));
@@ -279,20 +673,57 @@ bool vivid_on_entry(vivid_node_t *node VIVID_UML_ARGS(, const char *action_text)
 
 bool vivid_on_exit(vivid_node_t *node VIVID_UML_ARGS(, const char *action_text));
 
-bool vivid_on_event(vivid_node_t *node, const char *name VIVID_PARAM_ARGS(, const void **param VIVID_PARAM_STATIC_ARGS(, size_t param_size)) VIVID_UML_ARGS(, vivid_state_t target_fn, const char *guard_text, const char *target_name, const char *action_text, const char *json_props));
+bool vivid_on_event(vivid_node_t *node, vivid_event_t *event VIVID_PARAM_ARGS(, const void **param VIVID_PARAM_STATIC_ARGS(, size_t param_size)) VIVID_UML_ARGS(, vivid_state_t target_fn, const char *guard_text, const char *target_name, const char *action_text, const char *json_props));
 
-bool vivid_on_timeout(vivid_node_t *node, const char *name, vivid_time_t timeout VIVID_UML_ARGS(, vivid_state_t target_fn, const char *timeout_text, const char *guard_text, const char *target_name, const char *action_text, const char *json_props));
+bool vivid_on_timeout(vivid_node_t *node, vivid_event_t *event, vivid_time_t timeout VIVID_UML_ARGS(, vivid_state_t target_fn, const char *timeout_text, const char *guard_text, const char *target_name, const char *action_text, const char *json_props));
 
-bool vivid_jump(vivid_node_t *node VIVID_PARAM_ARGS(, const void **param, const char *param_event_name) VIVID_UML_ARGS(, vivid_state_t target_fn, const char *guard_text, const char *target_name, const char *action_text, const char *json_props));
+bool vivid_jump(vivid_node_t *node VIVID_PARAM_ARGS(, const void **param, vivid_event_t *param_event) VIVID_UML_ARGS(, vivid_state_t target_fn, const char *guard_text, const char *target_name, const char *action_text, const char *json_props));
 
 bool vivid_transit(vivid_node_t *node, bool guard, vivid_state_t target_fn VIVID_LOG_ARGS(, const char *type, const char *name, const char *guard_text, const char *target_name));
 
-void vivid_queue_event(vivid_sm_t *me, const char *name VIVID_PARAM_ARGS(, VIVID_PARAM_STATIC_ARGS(const) void *param, VIVID_PARAM_STATIC_ARGS(size_t param_size) VIVID_PARAM_DYNAMIC_ARGS(vivid_param_destructor_t param_destructor)));
+void vivid_queue_event(vivid_sm_t *me, const vivid_event_t *event VIVID_PARAM_ARGS(, VIVID_PARAM_STATIC_ARGS(const) void *param, VIVID_PARAM_STATIC_ARGS(size_t param_size) VIVID_PARAM_DYNAMIC_ARGS(vivid_param_destructor_t param_destructor)));
+
+// Same as vivid_queue_event(), except that the event is dropped instead of dispatched from the given
+// time of binding->get_time() on, 0 for never. vivid_queue_event() sets it from the ttl of the event.
+// The time is only read again before dispatching the events that have a deadline.
+void vivid_queue_event_with_deadline(vivid_sm_t *me, const vivid_event_t *event, vivid_time_t deadline VIVID_PARAM_ARGS(, VIVID_PARAM_STATIC_ARGS(const) void *param, VIVID_PARAM_STATIC_ARGS(size_t param_size) VIVID_PARAM_DYNAMIC_ARGS(vivid_param_destructor_t param_destructor)));
+
+#if VIVID_PARAM
+// Reserves an event with a param of param_size bytes, and returns the storage of the param for the
+// producer to fill before vivid_commit_event(), or NULL if the event is not queued, as it is already
+// queued and coalesced, or lost. With VIVID_PARAM_STATIC, the storage is the param of the entry of
+// the queue, so that large params are not copied, see vivid_queue_reserve(): the events queued after
+// it are only dispatched once it is committed, and only VIVID_OVERLOAD_BLOCK applies if the queue is
+// full. With VIVID_PARAM_DYNAMIC, the storage is allocated with the binding.
+void *vivid_reserve_event(vivid_sm_t *me, const vivid_event_t *event, size_t param_size, vivid_event_reservation_t *reservation);
+
+// Queues an event reserved by vivid_reserve_event(), from the thread that reserved it:
+void vivid_commit_event(vivid_sm_t *me, const vivid_event_t *event, vivid_event_reservation_t *reservation);
+#endif
+
+// Same as vivid_queue_event(), except that the event is handled right away, without going through
+// the queue and the binding, even before the events already queued. If the state machine is already
+// handling an event, the new event is handled right after it instead, to run to completion.
+// Note: this should only be called from the thread handling the events.
+void vivid_dispatch_event(vivid_sm_t *me, const vivid_event_t *event VIVID_PARAM_ARGS(, VIVID_PARAM_STATIC_ARGS(const) void *param, VIVID_PARAM_STATIC_ARGS(size_t param_size) VIVID_PARAM_DYNAMIC_ARGS(vivid_param_destructor_t param_destructor)));
 
 bool vivid_is_in(vivid_sm_t *me, vivid_state_t state);
 
 vivid_state_t vivid_get_state(vivid_sm_t *me, vivid_state_t parent_state VIVID_LOG_ARGS(, const char **name));
 
+// Copies up to max_states active states, including the root and the parallel regions, in document
+// order, and returns the number of active states. The names are optional.
+// Note: this should be called from the thread handling the events, e.g. from a state function.
+size_t vivid_get_active_states(vivid_sm_t *me, vivid_state_t *states, size_t max_states VIVID_LOG_ARGS(, const char **names));
+
+#if !VIVID_LOG
+#define vivid_set_log_level(me, level)
+#else
+// Overrides the log level of the binding for this state machine, e.g. to debug a single instance.
+// Note: this should be called from the thread handling the events.
+void vivid_set_log_level(vivid_sm_t *me, vivid_log_level_t level);
+#endif
+
 #if !VIVID_UML
 #define vivid_save_uml(me, filename)
 #else
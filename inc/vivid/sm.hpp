@@ -0,0 +1,728 @@
+// Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: Apache-2.0.
+
+#ifndef VIVID_SM_HPP
+#define VIVID_SM_HPP
+
+#include <vivid/binding.h>
+#include <vivid/util/log.h>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+// Header-only C++17 front-end, where the states, the events and the transitions are types:
+//
+//   struct off;
+//   struct on;
+//   struct root : vivid::composite<off, on> {}; // The first sub state is the default
+//   struct off {
+//       static void on_entry(toaster &me); // Optional, as is on_exit()
+//   };
+//   struct ev_button_press {}; // The members of an event are its parameters
+//   struct tm_popup {
+//       static constexpr vivid_time_t timeout = 10.0;
+//   };
+//   using transitions = vivid::list<
+//       vivid::on_event<off, ev_button_press, on>,
+//       vivid::on_event<on, ev_button_press, off, cancel>, // void cancel(toaster &me, const ev_button_press &event)
+//       vivid::on_timeout<on, tm_popup, off, pop_up>>;
+//   vivid::sm<toaster, root, transitions, 16U> vsm(binding, me);
+//
+// The topology, the transition paths and the handlers of each state are computed at compile time,
+// so dispatching an event is one indexed call into the guards, actions, exits and entries, inlined,
+// of the handlers offered the event. The front-end holds its queue and its state, and allocates
+// nothing, while the binding provides the timers and the wakeups of the queued events.
+//
+// The semantics are the ones of the C API: the event is offered from the root down to the active
+// leaf, each state taking the first of its transitions with a true guard. Internal transitions let
+// the event go on to the sub states, external ones exit up to the common ancestor, call the action
+// and enter down to the target, then its defaults. Parallel states, jumps and UML generation are
+// only available with the C API.
+
+namespace vivid {
+
+template <typename... Ts>
+struct list {
+};
+
+// State with sub states, the first of which is entered by default. Any other type is a leaf state:
+template <typename Default, typename... Others>
+struct composite {
+    using sub_states = list<Default, Others...>;
+};
+
+// Transition from the source state on the event, if the guard holds. The target is void for
+// internal transitions. The action and the guard are nullptr, or functions taking the context and
+// the event: void action(Context &me, const Event &event), bool guard(Context &me, const Event &event):
+template <typename Source, typename Event, typename Target, auto Action = nullptr, auto Guard = nullptr>
+struct on_event {
+    using source = Source;
+    using event = Event;
+    using target = Target;
+    static constexpr auto action = Action;
+    static constexpr auto guard = Guard;
+    static constexpr bool has_action = !std::is_null_pointer_v<decltype(Action)>;
+    static constexpr bool has_guard = !std::is_null_pointer_v<decltype(Guard)>;
+    static constexpr bool is_timeout = false;
+};
+
+// Same as on_event, on the expiry of the timer started when entering the source state and stopped
+// when exiting it. The timer type holds its duration, see the example above, and is owned by one state:
+template <typename Source, typename Timer, typename Target, auto Action = nullptr, auto Guard = nullptr>
+struct on_timeout : on_event<Source, Timer, Target, Action, Guard> {
+    static constexpr bool is_timeout = true;
+};
+
+namespace detail {
+
+    constexpr std::size_t npos = ~std::size_t { 0U };
+
+    template <typename T>
+    struct type_is {
+        using type = T;
+    };
+
+    template <typename State, typename = void>
+    struct sub_states_of {
+        using type = list<>;
+    };
+
+    template <typename State>
+    struct sub_states_of<State, std::void_t<typename State::sub_states>> {
+        using type = typename State::sub_states;
+    };
+
+    template <typename... Lists>
+    struct concat {
+        using type = list<>;
+    };
+
+    template <typename... Ts>
+    struct concat<list<Ts...>> {
+        using type = list<Ts...>;
+    };
+
+    template <typename... Ts, typename... Us, typename... Lists>
+    struct concat<list<Ts...>, list<Us...>, Lists...> {
+        using type = typename concat<list<Ts..., Us...>, Lists...>::type;
+    };
+
+    template <typename Unique, typename... Ts>
+    struct unique_impl {
+        using type = Unique;
+    };
+
+    template <typename... Us, typename T, typename... Ts>
+    struct unique_impl<list<Us...>, T, Ts...> {
+        using type = typename unique_impl<std::conditional_t<(std::is_same_v<T, Us> || ...), list<Us...>, list<Us..., T>>, Ts...>::type;
+    };
+
+    template <typename List>
+    struct unique;
+
+    template <typename... Ts>
+    struct unique<list<Ts...>> : unique_impl<list<>, Ts...> {
+    };
+
+    // States of a subtree in document order, that is the state followed by the subtrees of its sub states:
+    template <typename State, typename SubStates = typename sub_states_of<State>::type>
+    struct flatten;
+
+    template <typename State, typename... SubStates>
+    struct flatten<State, list<SubStates...>> {
+        using type = typename concat<list<State>, typename flatten<SubStates>::type...>::type;
+    };
+
+    // Events of the transitions, or timers of the timeout transitions, without duplicates:
+    template <bool Timeout, typename Transitions>
+    struct events_of;
+
+    template <bool Timeout, typename... Transitions>
+    struct events_of<Timeout, list<Transitions...>> {
+        using type = typename unique<typename concat<std::conditional_t<Transitions::is_timeout == Timeout, list<typename Transitions::event>, list<>>...>::type>::type;
+    };
+
+    template <typename First, typename List>
+    struct variant_of;
+
+    template <typename First, typename... Ts>
+    struct variant_of<First, list<Ts...>> {
+        using type = std::variant<First, Ts...>;
+    };
+
+    template <typename State, typename Context, typename = void>
+    struct has_on_entry : std::false_type {
+    };
+
+    template <typename State, typename Context>
+    struct has_on_entry<State, Context, std::void_t<decltype(State::on_entry(std::declval<Context &>()))>> : std::true_type {
+    };
+
+    template <typename State, typename Context, typename = void>
+    struct has_on_exit : std::false_type {
+    };
+
+    template <typename State, typename Context>
+    struct has_on_exit<State, Context, std::void_t<decltype(State::on_exit(std::declval<Context &>()))>> : std::true_type {
+    };
+
+    template <typename... Ts>
+    constexpr std::size_t size(list<Ts...>)
+    {
+        return sizeof...(Ts);
+    }
+
+    template <typename T, typename... Ts>
+    constexpr bool contains(list<Ts...>)
+    {
+        return (std::is_same_v<T, Ts> || ...);
+    }
+
+    // Returns the size of the list if not found:
+    template <typename T, typename... Ts>
+    constexpr std::size_t index_of(list<Ts...>)
+    {
+        constexpr bool matches[] = { std::is_same_v<T, Ts>..., true };
+        std::size_t index = 0U;
+        while (!matches[index]) {
+            index++;
+        }
+        return index;
+    }
+
+    template <std::size_t I, typename... Ts>
+    constexpr auto type_at(list<Ts...>)
+    {
+        return type_is<std::tuple_element_t<I, std::tuple<Ts...>>> {};
+    }
+
+    template <typename States, typename... SubStates>
+    constexpr void set_parents(std::size_t *parents, std::size_t parent, list<SubStates...>)
+    {
+        ((parents[index_of<SubStates>(States {})] = parent), ...);
+        (void)parents;
+        (void)parent;
+    }
+
+    template <typename... States>
+    constexpr std::array<std::size_t, sizeof...(States)> make_parents(list<States...>)
+    {
+        std::array<std::size_t, sizeof...(States)> parents {};
+        parents[0U] = npos;
+        std::size_t index = 0U;
+        (set_parents<list<States...>>(parents.data(), index++, typename sub_states_of<States>::type {}), ...);
+        return parents;
+    }
+
+    template <typename... States>
+    constexpr std::array<std::size_t, sizeof...(States)> make_subtree_ends(list<States...>)
+    {
+        std::array<std::size_t, sizeof...(States)> subtree_ends {};
+        std::size_t index = 0U;
+        ((subtree_ends[index] = index + size(typename flatten<States>::type {}), index++), ...);
+        return subtree_ends;
+    }
+
+    template <std::size_t N>
+    constexpr std::array<std::size_t, N> make_depths(const std::array<std::size_t, N> &parents)
+    {
+        std::array<std::size_t, N> depths {};
+        // The parents come first in document order:
+        for (std::size_t i = 1U; i < N; i++) {
+            depths[i] = depths[parents[i]] + 1U;
+        }
+        return depths;
+    }
+
+    template <std::size_t N>
+    constexpr std::size_t common_ancestor(const std::array<std::size_t, N> &parents, const std::array<std::size_t, N> &depths, std::size_t a, std::size_t b)
+    {
+        while (depths[a] > depths[b]) {
+            a = parents[a];
+        }
+        while (depths[b] > depths[a]) {
+            b = parents[b];
+        }
+        while (a != b) {
+            a = parents[a];
+            b = parents[b];
+        }
+        return a;
+    }
+
+    template <typename States, typename... Transitions>
+    constexpr bool has_valid_states(list<Transitions...>)
+    {
+        return ((contains<typename Transitions::source>(States {}) && (std::is_void_v<typename Transitions::target> || contains<typename Transitions::target>(States {}))) && ...);
+    }
+
+    // Returns the source state of the timeout transitions of a timer, or npos if they do not all
+    // have the same source:
+    template <typename Timer, typename States, typename... Transitions>
+    constexpr std::size_t timer_owner(list<Transitions...>)
+    {
+        constexpr std::size_t sources[] = { (std::is_same_v<typename Transitions::event, Timer> ? index_of<typename Transitions::source>(States {}) : npos)..., npos };
+        std::size_t owner = npos;
+        for (std::size_t source : sources) {
+            if (source == npos) {
+                continue;
+            }
+            if ((owner != npos) && (owner != source)) {
+                return npos;
+            }
+            owner = source;
+        }
+        return owner;
+    }
+
+    template <std::size_t N>
+    constexpr bool has_owners(const std::array<std::size_t, N> &owners)
+    {
+        for (std::size_t owner : owners) {
+            if (owner == npos) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <typename States, typename Transitions, typename... Timers>
+    constexpr std::array<std::size_t, sizeof...(Timers)> make_timer_owners(list<Timers...>)
+    {
+        return { { timer_owner<Timers, States>(Transitions {})... } };
+    }
+
+    template <typename Root>
+    struct topology {
+        using states = typename flatten<Root>::type;
+        static constexpr std::size_t num_states = size(states {});
+        static constexpr std::array<std::size_t, num_states> parents = make_parents(states {});
+        static constexpr std::array<std::size_t, num_states> subtree_ends = make_subtree_ends(states {});
+        static constexpr std::array<std::size_t, num_states> depths = make_depths(parents);
+        template <typename State>
+        static constexpr std::size_t index = index_of<State>(states {});
+        template <std::size_t I>
+        using state = typename decltype(type_at<I>(states {}))::type;
+    };
+
+} // namespace detail
+
+// State machine of a context, given the root state, the list of transitions and the number of
+// events its queue holds. The events are handled, and the actions called, in the thread of the
+// binding events:
+template <typename Context, typename Root, typename Transitions, std::size_t QueueSize>
+class sm {
+    using topology = detail::topology<Root>;
+    using states = typename topology::states;
+    using events = typename detail::events_of<false, Transitions>::type;
+    using timers = typename detail::events_of<true, Transitions>::type;
+    static constexpr std::size_t num_states = topology::num_states;
+    static constexpr std::size_t num_timers = detail::size(timers {});
+    static constexpr std::array<std::size_t, num_timers> timer_owners = detail::make_timer_owners<states, Transitions>(timers {});
+
+    static_assert(QueueSize > 0U, "The queue must hold at least one event");
+    static_assert(detail::size(typename detail::unique<states>::type {}) == num_states, "A state is a sub state of more than one state");
+    static_assert(detail::has_valid_states<states>(Transitions {}), "A transition has a source or a target that is not a state of the root");
+    static_assert(detail::has_owners(timer_owners), "A timer is used by the timeout transitions of more than one state");
+
+    struct timeout_event {
+        std::size_t timer;
+    };
+
+    struct timer {
+        sm *vsm;
+        vivid_binding_timer_t *binding_timer;
+        vivid_time_t due_time;
+        bool active;
+    };
+
+    using queue_entry = typename detail::variant_of<timeout_event, events>::type;
+
+public:
+    sm(vivid_binding_t *binding, Context &context)
+        : m_binding(binding)
+        , m_context(context)
+    {
+        m_binding_event = binding->create_event(binding, event_callback, this);
+        m_valid = (m_binding_event != nullptr);
+#if !VIVID_LOCKFREE
+        m_binding_mutex = binding->create_mutex(binding);
+        m_valid = m_valid && (m_binding_mutex != nullptr);
+#endif
+        for (timer &timer : m_timers) {
+            timer.vsm = this;
+            timer.binding_timer = binding->create_timer(binding, timer_callback, &timer);
+            m_valid = m_valid && (timer.binding_timer != nullptr);
+        }
+    }
+
+    ~sm()
+    {
+        for (timer &timer : m_timers) {
+            if (timer.binding_timer != nullptr) {
+                m_binding->destroy_timer(timer.binding_timer);
+            }
+        }
+#if !VIVID_LOCKFREE
+        if (m_binding_mutex != nullptr) {
+            m_binding->destroy_mutex(m_binding_mutex);
+        }
+#endif
+        if (m_binding_event != nullptr) {
+            m_binding->destroy_event(m_binding_event);
+        }
+    }
+
+    sm(const sm &) = delete;
+    sm &operator=(const sm &) = delete;
+
+    // Returns false if the binding could not create the event, mutex or timers of the state machine:
+    bool valid() const
+    {
+        return m_valid;
+    }
+
+    // Enters the initial states, otherwise entered when handling the first event:
+    void start()
+    {
+        if (m_leaf != detail::npos) {
+            return;
+        }
+        m_dispatching = true;
+        enter<0U>();
+        enter_defaults<0U>();
+        m_dispatching = false;
+    }
+
+    // Queues an event, from any thread, to be handled in the thread of the binding events:
+    template <typename Event>
+    bool post(const Event &event)
+    {
+        static_assert(detail::contains<Event>(events {}), "The event is not handled by any transition");
+        return push(queue_entry { std::in_place_type<Event>, event });
+    }
+
+    // Handles an event now, from the thread of the binding events. An event dispatched while
+    // handling another one is queued:
+    template <typename Event>
+    void dispatch(const Event &event)
+    {
+        static_assert(detail::contains<Event>(events {}), "The event is not handled by any transition");
+        if (m_dispatching) {
+            (void)post(event);
+            return;
+        }
+        start();
+        handle(event);
+    }
+
+    // Returns true if the state, or one of its sub states, is active:
+    template <typename State>
+    bool is_in() const
+    {
+        constexpr std::size_t index = topology::template index<State>;
+        static_assert(index < num_states, "Not a state of the root");
+        return (m_leaf != detail::npos) && (m_leaf >= index) && (m_leaf < topology::subtree_ends[index]);
+    }
+
+private:
+    template <std::size_t I>
+    using state = typename topology::template state<I>;
+
+    template <std::size_t K>
+    using timer_type = typename decltype(detail::type_at<K>(timers {}))::type;
+
+    static void event_callback(void *data)
+    {
+        static_cast<sm *>(data)->handle_queue();
+    }
+
+    static void timer_callback(void *data)
+    {
+        timer *expired = static_cast<timer *>(data);
+        sm *me = expired->vsm;
+        (void)me->push(queue_entry { std::in_place_type<timeout_event>, timeout_event { static_cast<std::size_t>(expired - me->m_timers.data()) } });
+    }
+
+    bool lock()
+    {
+#if VIVID_LOCKFREE
+        while (m_lock.test_and_set(std::memory_order_acquire)) {
+        }
+        return true;
+#else
+        return m_binding->lock_mutex(m_binding_mutex);
+#endif
+    }
+
+    void unlock()
+    {
+#if VIVID_LOCKFREE
+        m_lock.clear(std::memory_order_release);
+#else
+        m_binding->unlock_mutex(m_binding_mutex);
+#endif
+    }
+
+    bool push(queue_entry &&entry)
+    {
+        if (!lock()) {
+            return false;
+        }
+        if (m_queue_count == QueueSize) {
+            unlock();
+            vivid_log_error(m_binding, "queue event error");
+            if (m_binding->error_hook != nullptr) {
+                m_binding->error_hook(m_binding->app, VIVID_ERROR_QUEUE_EVENT);
+            }
+            return false;
+        }
+        m_queue[(m_queue_head + m_queue_count) % QueueSize] = std::move(entry);
+        m_queue_count++;
+        unlock();
+        m_binding->trigger_event(m_binding_event);
+        return true;
+    }
+
+    void handle_queue()
+    {
+        start();
+        for (;;) {
+            if (!lock()) {
+                return;
+            }
+            if (m_queue_count == 0U) {
+                unlock();
+                return;
+            }
+            queue_entry entry = std::move(m_queue[m_queue_head]);
+            m_queue_head = (m_queue_head + 1U) % QueueSize;
+            m_queue_count--;
+            unlock();
+            std::visit([this](const auto &event) { handle(event); }, entry);
+        }
+    }
+
+    void handle(const timeout_event &event)
+    {
+        static constexpr auto handlers = make_timeout_handlers(std::make_index_sequence<num_timers> {});
+        handlers[event.timer](*this);
+    }
+
+    template <std::size_t... Ks>
+    static constexpr std::array<void (*)(sm &), num_timers> make_timeout_handlers(std::index_sequence<Ks...>)
+    {
+        return { { &sm::handle_timeout<Ks>... } };
+    }
+
+    template <std::size_t K>
+    static void handle_timeout(sm &me)
+    {
+        timer &expired = me.m_timers[K];
+        if (!expired.active || (expired.due_time > me.m_binding->get_time(me.m_binding))) {
+            return; // Ignore late arriving timeouts
+        }
+        expired.active = false;
+        me.handle(timer_type<K> {});
+    }
+
+    template <typename Event>
+    void handle(const Event &event)
+    {
+        using handler_t = bool (*)(sm &, const Event &);
+        static constexpr std::array<handler_t, num_states> handlers = make_handlers<Event>(std::make_index_sequence<num_states> {});
+        m_dispatching = true;
+        (void)handlers[m_leaf](*this, event);
+        m_dispatching = false;
+    }
+
+    // Handlers of an event by active leaf state:
+    template <typename Event, std::size_t... Is>
+    static constexpr std::array<bool (*)(sm &, const Event &), num_states> make_handlers(std::index_sequence<Is...>)
+    {
+        return { { &sm::offer<Event, Is>... } };
+    }
+
+    // Offers an event to a state and its ancestors, from the root down, and returns true once a
+    // transition changes the active states:
+    template <typename Event, std::size_t I>
+    static bool offer(sm &me, const Event &event)
+    {
+        if constexpr (I != 0U) {
+            if (offer<Event, topology::parents[I]>(me, event)) {
+                return true;
+            }
+        }
+        return me.offer_state<Event, I>(event, Transitions {});
+    }
+
+    template <typename Event, std::size_t I, typename... Ts>
+    bool offer_state(const Event &event, list<Ts...>)
+    {
+        bool state_change = false;
+        (void)(try_transition<Ts, I>(event, state_change) || ...);
+        return state_change;
+    }
+
+    // Returns true if the transition handles the event in the state and its guard holds:
+    template <typename T, std::size_t I, typename Event>
+    bool try_transition(const Event &event, bool &state_change)
+    {
+        if constexpr (!std::is_same_v<typename T::event, Event> || (topology::template index<typename T::source> != I)) {
+            (void)event;
+            (void)state_change;
+            return false;
+        } else {
+            if constexpr (T::has_guard) {
+                if (!T::guard(m_context, event)) {
+                    return false;
+                }
+            }
+            if constexpr (std::is_void_v<typename T::target>) {
+                call_action<T>(event);
+            } else {
+                transit<T, I>(event);
+                state_change = true;
+            }
+            return true;
+        }
+    }
+
+    template <typename T, typename Event>
+    void call_action(const Event &event)
+    {
+        if constexpr (T::has_action) {
+            T::action(m_context, event);
+        } else {
+            (void)event;
+        }
+    }
+
+    // Exits up to the common ancestor of the source and the target, also exited if it is one of
+    // them, then calls the action and enters down to the target and its defaults:
+    template <typename T, std::size_t Source, typename Event>
+    void transit(const Event &event)
+    {
+        constexpr std::size_t target = topology::template index<typename T::target>;
+        constexpr std::size_t ancestor = detail::common_ancestor(topology::parents, topology::depths, Source, target);
+        constexpr bool reenter_ancestor = (ancestor == Source) || (ancestor == target);
+        exit_up_to(reenter_ancestor ? topology::parents[ancestor] : ancestor);
+        call_action<T>(event);
+        if constexpr (reenter_ancestor) {
+            enter<ancestor>();
+        }
+        enter_down<ancestor, target>();
+        enter_defaults<target>();
+    }
+
+    // Exits the active states, from the leaf up to, and excluding, a state:
+    void exit_up_to(std::size_t stop)
+    {
+        static constexpr auto exits = make_exits(std::make_index_sequence<num_states> {});
+        for (std::size_t index = m_leaf; index != stop; index = topology::parents[index]) {
+            exits[index](*this);
+        }
+    }
+
+    template <std::size_t... Is>
+    static constexpr std::array<void (*)(sm &), num_states> make_exits(std::index_sequence<Is...>)
+    {
+        return { { &sm::exit<Is>... } };
+    }
+
+    template <std::size_t I>
+    static void exit(sm &me)
+    {
+        me.stop_timers<I>(std::make_index_sequence<num_timers> {});
+        if constexpr (detail::has_on_exit<state<I>, Context>::value) {
+            state<I>::on_exit(me.m_context);
+        }
+    }
+
+    template <std::size_t I>
+    void enter()
+    {
+        if constexpr (detail::has_on_entry<state<I>, Context>::value) {
+            state<I>::on_entry(m_context);
+        }
+        start_timers<I>(std::make_index_sequence<num_timers> {});
+    }
+
+    // Enters the states below a state, down to another one:
+    template <std::size_t From, std::size_t To>
+    void enter_down()
+    {
+        if constexpr (To != From) {
+            enter_down<From, topology::parents[To]>();
+            enter<To>();
+        }
+    }
+
+    // Enters the default sub states of a state, the first one coming next in document order:
+    template <std::size_t I>
+    void enter_defaults()
+    {
+        if constexpr (topology::subtree_ends[I] > (I + 1U)) {
+            enter<I + 1U>();
+            enter_defaults<I + 1U>();
+        } else {
+            m_leaf = I;
+        }
+    }
+
+    template <std::size_t I, std::size_t... Ks>
+    void start_timers(std::index_sequence<Ks...>)
+    {
+        (start_timer<I, Ks>(), ...);
+    }
+
+    template <std::size_t I, std::size_t K>
+    void start_timer()
+    {
+        if constexpr (timer_owners[K] == I) {
+            timer &started = m_timers[K];
+            started.due_time = m_binding->get_time(m_binding) + VIVID_CONVERT_TIME(timer_type<K>::timeout);
+            m_binding->start_timer(started.binding_timer, VIVID_CONVERT_TIME(timer_type<K>::timeout));
+            started.active = true;
+        }
+    }
+
+    template <std::size_t I, std::size_t... Ks>
+    void stop_timers(std::index_sequence<Ks...>)
+    {
+        (stop_timer<I, Ks>(), ...);
+    }
+
+    template <std::size_t I, std::size_t K>
+    void stop_timer()
+    {
+        if constexpr (timer_owners[K] == I) {
+            m_binding->stop_timer(m_timers[K].binding_timer);
+            m_timers[K].active = false;
+        }
+    }
+
+    vivid_binding_t *m_binding;
+    Context &m_context;
+    vivid_binding_event_t *m_binding_event {};
+#if VIVID_LOCKFREE
+    std::atomic_flag m_lock = ATOMIC_FLAG_INIT;
+#else
+    vivid_binding_mutex_t *m_binding_mutex {};
+#endif
+    std::array<timer, num_timers> m_timers {};
+    std::array<queue_entry, QueueSize> m_queue {};
+    std::size_t m_queue_head {};
+    std::size_t m_queue_count {};
+    std::size_t m_leaf { detail::npos }; // Active leaf state, the others being its ancestors
+    bool m_dispatching {};
+    bool m_valid {};
+};
+
+} // namespace vivid
+
+#endif
@@ -18,17 +18,42 @@ extern "C" {
 #define vivid_log_destroy(me)
 #define vivid_log_error(binding, message)
 #else
-#define VIVID_LOG_ERROR(me, format, ...) vivid_log_formatted(me, VIVID_LOG_LEVEL_ERROR, format, ##__VA_ARGS__)
-#define VIVID_LOG_WARN(me, format, ...) vivid_log_formatted(me, VIVID_LOG_LEVEL_WARN, format, ##__VA_ARGS__)
-#define VIVID_LOG_INFO(me, format, ...) vivid_log_formatted(me, VIVID_LOG_LEVEL_INFO, format, ##__VA_ARGS__)
-#define VIVID_LOG_DEBUG(me, format, ...) vivid_log_formatted(me, VIVID_LOG_LEVEL_DEBUG, format, ##__VA_ARGS__)
+// The arguments are only evaluated, and the message formatted, if the level is enabled:
+#define VIVID_LOG_ERROR(me, format, ...) VIVID_LOG_LEVEL(me, VIVID_LOG_LEVEL_ERROR, format, ##__VA_ARGS__)
+#define VIVID_LOG_WARN(me, format, ...) VIVID_LOG_LEVEL(me, VIVID_LOG_LEVEL_WARN, format, ##__VA_ARGS__)
+#define VIVID_LOG_INFO(me, format, ...) VIVID_LOG_LEVEL(me, VIVID_LOG_LEVEL_INFO, format, ##__VA_ARGS__)
+#define VIVID_LOG_DEBUG(me, format, ...) VIVID_LOG_LEVEL(me, VIVID_LOG_LEVEL_DEBUG, format, ##__VA_ARGS__)
+#define VIVID_LOG_LEVEL(me, level, format, ...) \
+    (vivid_log_enabled(me, level) ? vivid_log_formatted(me, level, format, ##__VA_ARGS__) : (void)0)
 
 typedef struct vivid_log vivid_log_t;
 
+struct vivid_log {
+    vivid_binding_t *binding;
+    char *buffer;
+    size_t buffer_size;
+    vivid_log_level_t level;
+    bool has_level; // Otherwise, the level of the binding applies
+};
+
+// A binding left with the zero level logs all levels, set log to NULL to log none:
+static inline vivid_log_level_t vivid_log_binding_level(const vivid_binding_t *binding)
+{
+    return (binding->log_level == VIVID_LOG_LEVEL_NONE) ? VIVID_LOG_LEVEL_DEBUG : binding->log_level;
+}
+
+static inline bool vivid_log_enabled(const vivid_log_t *me, vivid_log_level_t level)
+{
+    return (me != NULL) && (me->binding->log != NULL) && (level <= (me->has_level ? me->level : vivid_log_binding_level(me->binding)));
+}
+
 vivid_log_t *vivid_log_create(vivid_binding_t *binding, size_t buffer_size);
 
 void vivid_log_destroy(vivid_log_t *me);
 
+// Overrides the level of the binding:
+void vivid_log_set_level(vivid_log_t *me, vivid_log_level_t level);
+
 void vivid_log_formatted(vivid_log_t *me, vivid_log_level_t level, const char *format, ...);
 
 void vivid_log_error(vivid_binding_t *binding, const char *message);
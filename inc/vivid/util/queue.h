@@ -4,6 +4,7 @@
 #ifndef VIVID_QUEUE_H
 #define VIVID_QUEUE_H
 
+#include <stdint.h>
 #include <vivid/binding.h>
 
 #ifdef __cplusplus
@@ -44,13 +45,18 @@ extern "C" {
 #define VIVID_PARAM_DYNAMIC_ARGS(...)
 #endif
 
+#define VIVID_EVENT_ID_NONE 0U
+
 typedef struct vivid_queue vivid_queue_t;
+typedef uint16_t vivid_event_id_t;
 #if VIVID_PARAM_DYNAMIC
 typedef void (*vivid_param_destructor_t)(void *param);
 #endif
 
 typedef struct {
     const char *name;
+    vivid_event_id_t id;
+    vivid_time_t deadline; // Time from which the entry is stale, 0 if none, see vivid_queue_try_push()
 #if VIVID_PARAM
     void *param;
 #if VIVID_PARAM_DYNAMIC
@@ -61,11 +67,82 @@ typedef struct {
 #endif
 } vivid_queue_entry_t;
 
+// Threads pushing into a queue. Only one thread may pop from it in either case.
+typedef enum {
+    VIVID_QUEUE_MULTI_PRODUCER,
+    VIVID_QUEUE_SINGLE_PRODUCER // Pushed from one thread only, wait-free with VIVID_LOCKFREE
+} vivid_queue_producers_t;
+
+typedef struct vivid_queue_pool vivid_queue_pool_t;
+
+// Creates a pool of segments of segment_size entries, which the queues take once their own entries
+// are full, see vivid_queue_set_pool(). The segments popped are kept as spares, and only freed with
+// the pool. Up to max_bytes are allocated for the segments, 0 for no limit, e.g. per binding. The
+// entries hold params of up to max_param_size, e.g. the largest vivid_get_max_param_size() of the
+// state machines sharing the pool.
+vivid_queue_pool_t *vivid_queue_create_pool(vivid_binding_t *binding, size_t segment_size, size_t max_bytes VIVID_PARAM_STATIC_ARGS(, size_t max_param_size));
+
+// Creates a pool taking the segments of the given pool, up to max_bytes held by its queues, 0 for no
+// limit besides the one of the given pool, e.g. per state machine. The given pool must outlive it.
+vivid_queue_pool_t *vivid_queue_create_sub_pool(vivid_queue_pool_t *pool, size_t max_bytes);
+
+// The queues of the pool must be destroyed first:
+void vivid_queue_destroy_pool(vivid_queue_pool_t *me);
+
+// Returns the bytes allocated by a pool, or held by the queues of a sub-pool:
+size_t vivid_queue_get_pool_bytes(vivid_queue_pool_t *me);
+
+// Same as vivid_queue_create_with_producers(), with VIVID_QUEUE_MULTI_PRODUCER.
 vivid_queue_t *vivid_queue_create(vivid_binding_t *binding, size_t size VIVID_PARAM_STATIC_ARGS(, size_t max_param_size));
 
+// Creates a queue of at least size entries. With VIVID_LOCKFREE, the size is rounded up to a power
+// of 2, and a single producer claims its entries without any compare and swap. Without it, the
+// entries are always claimed with the mutex of the binding.
+vivid_queue_t *vivid_queue_create_with_producers(vivid_binding_t *binding, size_t size, vivid_queue_producers_t producers VIVID_PARAM_STATIC_ARGS(, size_t max_param_size));
+
 void vivid_queue_destroy(vivid_queue_t *me);
 
-bool vivid_queue_push(vivid_queue_t *me, const char *name VIVID_PARAM_ARGS(, VIVID_PARAM_STATIC_ARGS(const) void *param, VIVID_PARAM_STATIC_ARGS(size_t param_size) VIVID_PARAM_DYNAMIC_ARGS(vivid_param_destructor_t param_destructor)));
+// Lets the queue grow with segments of the pool once its own entries are full, instead of failing to
+// push. The pool must outlive the queue. Must be called before pushing any entry.
+bool vivid_queue_set_pool(vivid_queue_t *me, vivid_queue_pool_t *pool);
+
+bool vivid_queue_push(vivid_queue_t *me, vivid_event_id_t id, const char *name VIVID_PARAM_ARGS(, VIVID_PARAM_STATIC_ARGS(const) void *param, VIVID_PARAM_STATIC_ARGS(size_t param_size) VIVID_PARAM_DYNAMIC_ARGS(vivid_param_destructor_t param_destructor)));
+
+// Same as vivid_queue_push(), without logging an error if the queue is full, and with the deadline of
+// the entry, 0 for none. The queue only stores it, for the consumer to drop the entry once stale.
+bool vivid_queue_try_push(vivid_queue_t *me, vivid_event_id_t id, const char *name, vivid_time_t deadline VIVID_PARAM_ARGS(, VIVID_PARAM_STATIC_ARGS(const) void *param, VIVID_PARAM_STATIC_ARGS(size_t param_size) VIVID_PARAM_DYNAMIC_ARGS(vivid_param_destructor_t param_destructor)));
+
+#if !VIVID_LOCKFREE
+typedef enum {
+    VIVID_QUEUE_REPLACE_OLDEST, // The entries following it move up, and the entry is pushed last
+    VIVID_QUEUE_REPLACE_SAME_ID // The entry takes the place of the last one of the same id
+} vivid_queue_replace_t;
+
+// Pushes the entry into a full queue in place of another one, and returns the id of the entry
+// replaced, or VIVID_EVENT_ID_NONE if none could be. The front is never replaced, as the consumer
+// may be using it, and no entry is while the segments of a pool are in use, or while an entry is
+// reserved. Only available with a mutex, as the producers of a lock-free queue cannot move the
+// entries already pushed.
+vivid_event_id_t vivid_queue_push_replacing(vivid_queue_t *me, vivid_queue_replace_t replace, vivid_event_id_t id, const char *name, vivid_time_t deadline VIVID_PARAM_ARGS(, VIVID_PARAM_STATIC_ARGS(const) void *param, VIVID_PARAM_STATIC_ARGS(size_t param_size) VIVID_PARAM_DYNAMIC_ARGS(vivid_param_destructor_t param_destructor)));
+#endif
+
+#if VIVID_PARAM_STATIC
+// Entry reserved by vivid_queue_reserve(), until committed by vivid_queue_commit():
+typedef struct {
+    vivid_queue_entry_t *entry;
+    size_t position; // Of the slot of the entry, to publish it
+} vivid_queue_reservation_t;
+
+// Reserves the next entry of the queue, and returns its param storage for the producer to fill in
+// place with param_size bytes, instead of copying them from another buffer, or returns NULL if the
+// queue is full. Only the entries of the queue itself are reserved, not the segments of a pool. The
+// consumer does not see the entry, nor the entries queued after it, until it is committed, so each
+// reservation must be committed, right after the param is filled.
+void *vivid_queue_reserve(vivid_queue_t *me, size_t param_size, vivid_queue_reservation_t *reservation);
+
+// Publishes a reserved entry to the consumer, see vivid_queue_try_push() for the deadline:
+void vivid_queue_commit(vivid_queue_t *me, const vivid_queue_reservation_t *reservation, vivid_event_id_t id, const char *name, vivid_time_t deadline);
+#endif
 
 bool vivid_queue_empty(vivid_queue_t *me);
 
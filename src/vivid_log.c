@@ -7,12 +7,6 @@
 #include <stdarg.h>
 #include <stdio.h>
 
-struct vivid_log {
-    vivid_binding_t *binding;
-    char *buffer;
-    size_t buffer_size;
-};
-
 vivid_log_t *vivid_log_create(vivid_binding_t *binding, size_t buffer_size)
 {
     vivid_log_t *me = (vivid_log_t *)binding->calloc(binding, 1U, sizeof(*me));
@@ -38,6 +32,12 @@ void vivid_log_destroy(vivid_log_t *me)
     me->binding->free(me);
 }
 
+void vivid_log_set_level(vivid_log_t *me, vivid_log_level_t level)
+{
+    me->level = level;
+    me->has_level = true;
+}
+
 void vivid_log_formatted(vivid_log_t *me, vivid_log_level_t level, const char *format, ...)
 {
     if ((me == NULL) || (me->binding->log == NULL)) {
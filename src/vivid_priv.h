@@ -4,7 +4,6 @@
 #ifndef VIVID_PRIV_H
 #define VIVID_PRIV_H
 
-#include "vivid_map.h"
 #include "vivid_uml.h"
 #include <vivid/sm.h>
 #include <vivid/util/log.h>
@@ -17,27 +16,82 @@
 #define STATE_TYPE_QUALIFIER
 #endif
 
+// Ids of the events used internally, followed by the first id available to applications:
+typedef enum {
+    VIVID_EVENT_ID_INIT = VIVID_EVENT_ID_NONE + 1U,
+    VIVID_EVENT_ID_ENTRY,
+    VIVID_EVENT_ID_EXIT,
+    VIVID_EVENT_ID_JUMP,
+    VIVID_EVENT_ID_UML,
+    VIVID_EVENT_ID_UML_DEFAULT,
+    VIVID_EVENT_ID_FIRST
+} vivid_event_id_internal_t;
+
+typedef struct vivid_sm_timer vivid_sm_timer_t;
+typedef struct vivid_timer_slot vivid_timer_slot_t;
+typedef struct vivid_timer_info vivid_timer_info_t;
+
+// Pending node of a tree walk, with the step to resume it at:
+typedef struct {
+    vivid_node_t *node;
+    uint8_t step;
+} vivid_walk_frame_t;
+
+// Transition from a source node to a target node, computed at its first firing. The path holds the
+// nodes to exit, from the source up to the ancestor, followed by the nodes to enter, from the
+// ancestor down to the target:
+typedef struct vivid_transition_path {
+    struct vivid_transition_path *next;
+    vivid_state_t target_fn;
+    vivid_node_t *ancestor;
+    bool reenter_ancestor;
+    size_t num_exits;
+    size_t num_entries;
+    vivid_node_t *path[];
+} vivid_transition_path_t;
+
+// State of a node in one instance:
 struct vivid_node {
     vivid_sm_t *vsm;
-    vivid_state_t fn;
-    vivid_node_t *parent;
-    vivid_node_t *children;
-    vivid_node_t *siblings;
-    vivid_node_t *default_child;
-    vivid_node_t *STATE_TYPE_QUALIFIER state;
-    size_t depth;
-    const vivid_queue_entry_t *current_event;
-#if VIVID_PARAM
-    const vivid_queue_entry_t *last_event;
-#endif
+    const vivid_node_info_t *info;
+    vivid_transition_path_t *transitions; // Transitions from this node taken so far
+    vivid_node_index_t STATE_TYPE_QUALIFIER state;
+    bool active;
+    bool entered; // Entered since the start of the last walk of an event
+    bool jump_pending; // Entered with jumps to evaluate
+};
+
+// Topology of a state machine, recorded once by walking its state functions or taken from generated
+// tables, and read-only from then on:
+struct vivid_sm_class {
+    vivid_binding_t *binding;
 #if VIVID_LOG
+    vivid_log_t *log;
     const char *name;
 #endif
 #if VIVID_UML
-    const char *json_props;
+    vivid_uml_t *uml;
+#endif
+#if VIVID_PARAM_STATIC
+    size_t max_param_size;
+#endif
+    void *arena; // Single allocation holding the timers, recorded nodes, event bit sets and node table
+    vivid_timer_info_t *timers;
+    const vivid_timer_info_t **node_timers; // Timers of each node, recorded during init
+    const vivid_node_info_t *nodes;
+    vivid_node_info_t *recorded_nodes; // Same as nodes when recorded, NULL when generated
+    uint32_t *handlers; // Bit sets of the events handled by each node, then by the node or any descendant
+    vivid_node_index_t *node_table; // Node indices by state function, using open addressing
+#if VIVID_DISPATCH
+    vivid_dispatch_t dispatch;
+    uint16_t *event_indices; // Position of each event id in the events of the tables, for dispatch
 #endif
-    vivid_node_type_t type;
-    bool parallel_children;
+    uint32_t *coalesced_events; // Bit set of the coalesced events handled, recorded during init
+    size_t node_table_mask;
+    size_t num_timers;
+    size_t num_nodes;
+    size_t num_event_words;
+    size_t max_depth;
 };
 
 struct vivid_sm {
@@ -47,33 +101,70 @@ struct vivid_sm {
     vivid_binding_mutex_t *binding_mutex;
 #endif
 #if VIVID_LOG
-    vivid_log_t *log;
+    vivid_log_t *log; // The log of the class, unless created on another binding or given its own level
     const char *name;
 #endif
-#if VIVID_UML
-    vivid_uml_t *uml;
-#endif
-#if VIVID_PARAM_STATIC
-    size_t max_param_size;
-#endif
+    vivid_sm_class_t *sm_class;
     void *app;
-    vivid_node_t *root_node;
-    vivid_map_t *node_map;
-    vivid_map_t *timer_map;
-    vivid_queue_t *event_queue;
+    const vivid_queue_entry_t *current_event; // Event of the state function being called
+#if VIVID_PARAM
+    const vivid_queue_entry_t *last_event; // Event followed by the jumps being evaluated
+#endif
+    void *arena; // Single allocation holding the timers, queue array, nodes, walk stack, event bit set and node index arrays
+    vivid_sm_timer_t *timers;
+    vivid_timer_slot_t *spare_timers; // Binding timers not held by any timer, see acquire_timer()
+    vivid_node_t *nodes;
+    vivid_walk_frame_t *walk_stack; // Shared by the tree walks
+    size_t walk_stack_size;
+    size_t walk_stack_top;
+    vivid_node_index_t *active_nodes; // Indices of the active nodes, in document order
+    size_t num_active_nodes;
+    vivid_node_index_t *jump_nodes; // Indices of the nodes with jumps to evaluate, see jump()
+    size_t num_jump_nodes;
+    uint32_t STATE_TYPE_QUALIFIER *pending_events; // Bit set of the coalesced events in the queue
+    size_t num_node_lookups;
+    size_t next_timer;
+    size_t next_node;
+    vivid_queue_t **event_queues; // One per priority lane, from the lowest priority to the highest
+    size_t num_lanes;
+    vivid_queue_t *local_queue; // Events dispatched by the thread while dispatching, see vivid_dispatch_event()
+    size_t local_queue_size; // Size of each queue
+    vivid_queue_pool_t *queue_pool; // Segments taken by the queues once full, see vivid_set_queue_pool()
     vivid_state_change_callback_t state_change_callback;
+    size_t event_budget_count; // Events handled per wakeup, 0 for no limit
+    vivid_time_t event_budget_time; // Time spent handling events per wakeup, 0 for no limit
+    vivid_overload_policy_t overload_policy;
+    vivid_time_t block_timeout; // For VIVID_OVERLOAD_BLOCK
+    vivid_watermark_callback_t watermark_callback;
+    size_t high_watermark;
+    size_t low_watermark;
+    size_t STATE_TYPE_QUALIFIER num_queued; // Events in the queues, only counted with a watermark callback
+    bool STATE_TYPE_QUALIFIER above_high_watermark;
+    size_t STATE_TYPE_QUALIFIER num_dropped_events;
+    vivid_time_t STATE_TYPE_QUALIFIER next_report_time; // Of the events lost or dropped, see report_overload()
+    size_t *num_expired_events; // By event id, allocated once an event expires, see drop_expired_event()
+    size_t num_expired_total;
     struct {
-        vivid_node_t *target;
-        vivid_node_t *ancestor;
-        bool reenter_ancestor;
+        const vivid_transition_path_t *path;
         bool state_change;
     } transition;
+    bool owns_class; // Set if created by vivid_create_sm()
     bool init;
+    bool dispatching; // Set while handling an event, or entering the initial states
+    bool init_sizing; // Set while counting the nodes and timers, before the arena is allocated
+    bool init_timers; // Set while recording the timers only, see vivid_create_sm_class_from_tables()
     bool init_error;
-    bool jump;
+    bool nodes_entered;
     bool event_handled;
 };
 
-void vivid_call_node(vivid_node_t *node, const char *event_string);
+static inline vivid_node_t *vivid_get_node(const vivid_sm_t *me, vivid_node_index_t index)
+{
+    return (index == VIVID_NODE_INDEX_NONE) ? NULL : &me->nodes[index];
+}
+
+vivid_node_t *vivid_find_node(vivid_sm_t *me, vivid_state_t fn);
+
+void vivid_call_node(vivid_node_t *node, const vivid_event_t *event);
 
 #endif
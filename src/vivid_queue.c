@@ -7,46 +7,300 @@
 
 #if VIVID_LOCKFREE
 #include <stdatomic.h>
-#define INDEX_TYPE_QUALIFIER _Atomic
+#include <stdint.h>
+
+#ifndef VIVID_CACHE_LINE_SIZE
+#define VIVID_CACHE_LINE_SIZE 64U
+#endif
+
+// The top bit of the write position is set while the entries are queued in the segments of the
+// pool, so that claiming a slot fails from then on. The positions wrap around with the other bits:
+#define SPILLED (~(SIZE_MAX >> 1U))
+#define POSITION_MASK (SIZE_MAX >> 1U)
+#endif
+
+// Entry of the queue. Without a mutex, it holds the position it is ready for: the position of the
+// slot while free, plus one once filled by a producer, then plus the size once popped, for the
+// producers of the next lap. With a mutex, it is only ready once filled, as it may be reserved:
+typedef struct {
+#if VIVID_LOCKFREE
+    _Atomic size_t sequence;
 #else
-#define INDEX_TYPE_QUALIFIER
+    bool ready;
 #endif
+    vivid_queue_entry_t entry;
+} vivid_queue_slot_t;
 
-struct vivid_queue {
+// Entries of a queue taken from a pool once the slots of the queue are full. The entries are
+// filled once each, from the first, and the segment goes back to the pool once they are popped:
+typedef struct vivid_queue_segment vivid_queue_segment_t;
+struct vivid_queue_segment {
+    vivid_queue_segment_t *next;
+    size_t read;
+    size_t write;
+    vivid_queue_entry_t entries[]; // Followed by the param buffer
+};
+
+struct vivid_queue_pool {
     vivid_binding_t *binding;
-    vivid_queue_entry_t *entry_buffer;
-    size_t size;
-    INDEX_TYPE_QUALIFIER size_t read;
-    INDEX_TYPE_QUALIFIER size_t write;
+    vivid_queue_pool_t *root; // Pool holding the spare segments and the lock, itself if created without a parent
+    size_t segment_size;
+    size_t segment_bytes;
+    size_t max_bytes; // 0 for no limit
+    size_t bytes; // Allocated by the root, taken by the queues of the others, protected by the lock of the root
+    vivid_queue_segment_t *spare_segments;
+#if VIVID_PARAM_STATIC
+    size_t max_param_size;
+#endif
 #if VIVID_LOCKFREE
-    _Atomic size_t pending;
-    _Atomic bool *ready_buffer;
+    atomic_flag lock;
 #else
     vivid_binding_mutex_t *binding_mutex;
 #endif
+};
+
+struct vivid_queue {
+    vivid_binding_t *binding;
+    vivid_queue_slot_t *slots;
+    size_t size;
+#if VIVID_LOCKFREE
+    bool single_producer;
+#endif
 #if VIVID_PARAM_STATIC
     size_t max_param_size;
     char *param_buffer;
+#endif
+    vivid_queue_pool_t *pool; // NULL unless set by vivid_queue_set_pool()
+    vivid_queue_segment_t *overflow_head;
+    vivid_queue_segment_t *overflow_tail;
+#if VIVID_LOCKFREE
+    atomic_flag overflow_lock;
+    // The positions claimed by the producers and popped by the consumer each have their own cache
+    // line, apart from the fields above, which are only read once the queue is created, or written
+    // once the slots are full:
+    char write_padding[VIVID_CACHE_LINE_SIZE];
+    _Atomic size_t write;
+    char read_padding[VIVID_CACHE_LINE_SIZE - sizeof(size_t)];
+    size_t read; // Only used by the consumer
+    char end_padding[VIVID_CACHE_LINE_SIZE - sizeof(size_t)];
+#else
+    vivid_binding_mutex_t *binding_mutex;
+    size_t read;
+    size_t write;
+    size_t num_reserved; // Entries reserved and not committed yet, see vivid_queue_reserve()
 #endif
 };
 
+#if VIVID_LOCKFREE
+static void lock_spin(atomic_flag *lock)
+{
+    while (atomic_flag_test_and_set_explicit(lock, memory_order_acquire)) {
+    }
+}
+
+static void unlock_spin(atomic_flag *lock)
+{
+    atomic_flag_clear_explicit(lock, memory_order_release);
+}
+#endif
+
+static void lock_pool(vivid_queue_pool_t *root)
+{
+#if VIVID_LOCKFREE
+    lock_spin(&root->lock);
+#else
+    (void)root->binding->lock_mutex(root->binding_mutex);
+#endif
+}
+
+static void unlock_pool(vivid_queue_pool_t *root)
+{
+#if VIVID_LOCKFREE
+    unlock_spin(&root->lock);
+#else
+    root->binding->unlock_mutex(root->binding_mutex);
+#endif
+}
+
+vivid_queue_pool_t *vivid_queue_create_pool(vivid_binding_t *binding, size_t segment_size, size_t max_bytes VIVID_PARAM_STATIC_ARGS(, size_t max_param_size))
+{
+    if (segment_size == 0U) {
+        vivid_log_error(binding, "queue segment size is 0");
+        return NULL;
+    }
+    vivid_queue_pool_t *me = (vivid_queue_pool_t *)binding->calloc(binding, 1U, sizeof(*me));
+    if (me == NULL) {
+        return NULL;
+    }
+    me->binding = binding;
+    me->root = me;
+    me->segment_size = segment_size;
+    me->max_bytes = max_bytes;
+#if VIVID_PARAM_STATIC
+    me->max_param_size = max_param_size;
+    me->segment_bytes = sizeof(vivid_queue_segment_t) + (segment_size * (sizeof(vivid_queue_entry_t) + max_param_size));
+#else
+    me->segment_bytes = sizeof(vivid_queue_segment_t) + (segment_size * sizeof(vivid_queue_entry_t));
+#endif
+#if VIVID_LOCKFREE
+    atomic_flag_clear(&me->lock);
+#else
+    me->binding_mutex = binding->create_mutex(binding);
+    if (me->binding_mutex == NULL) {
+        binding->free(me);
+        return NULL;
+    }
+#endif
+    return me;
+}
+
+vivid_queue_pool_t *vivid_queue_create_sub_pool(vivid_queue_pool_t *pool, size_t max_bytes)
+{
+    vivid_queue_pool_t *root = pool->root;
+    vivid_queue_pool_t *me = (vivid_queue_pool_t *)root->binding->calloc(root->binding, 1U, sizeof(*me));
+    if (me == NULL) {
+        return NULL;
+    }
+    me->binding = root->binding;
+    me->root = root;
+    me->segment_size = root->segment_size;
+    me->segment_bytes = root->segment_bytes;
+    me->max_bytes = max_bytes;
+#if VIVID_PARAM_STATIC
+    me->max_param_size = root->max_param_size;
+#endif
+    return me;
+}
+
+void vivid_queue_destroy_pool(vivid_queue_pool_t *me)
+{
+    if (me == NULL) {
+        return;
+    }
+    if (me->root == me) {
+        while (me->spare_segments != NULL) {
+            vivid_queue_segment_t *segment = me->spare_segments;
+            me->spare_segments = segment->next;
+            me->binding->free(segment);
+        }
+#if !VIVID_LOCKFREE
+        me->binding->destroy_mutex(me->binding_mutex);
+#endif
+    }
+    me->binding->free(me);
+}
+
+size_t vivid_queue_get_pool_bytes(vivid_queue_pool_t *me)
+{
+    lock_pool(me->root);
+    size_t bytes = me->bytes;
+    unlock_pool(me->root);
+    return bytes;
+}
+
+static bool has_room(const vivid_queue_pool_t *me)
+{
+    return (me->max_bytes == 0U) || ((me->bytes + me->segment_bytes) <= me->max_bytes);
+}
+
+// Takes a spare segment of the root, or allocates one, within the limits of the pool and the root:
+static vivid_queue_segment_t *take_segment(vivid_queue_pool_t *me)
+{
+    vivid_queue_pool_t *root = me->root;
+    lock_pool(root);
+    if ((me != root) && !has_room(me)) {
+        unlock_pool(root);
+        return NULL;
+    }
+    vivid_queue_segment_t *segment = root->spare_segments;
+    if (segment != NULL) {
+        root->spare_segments = segment->next;
+    } else if (has_room(root)) {
+        root->bytes += root->segment_bytes;
+    } else {
+        unlock_pool(root);
+        return NULL;
+    }
+    if (me != root) {
+        me->bytes += me->segment_bytes;
+    }
+    unlock_pool(root);
+
+    // Allocate the segment outside of the lock, as its bytes are already counted:
+    if (segment == NULL) {
+        segment = (vivid_queue_segment_t *)root->binding->calloc(root->binding, 1U, root->segment_bytes);
+        if (segment == NULL) {
+            lock_pool(root);
+            root->bytes -= root->segment_bytes;
+            if (me != root) {
+                me->bytes -= me->segment_bytes;
+            }
+            unlock_pool(root);
+            return NULL;
+        }
+#if VIVID_PARAM_STATIC
+        char *param_buffer = (char *)&segment->entries[root->segment_size];
+        for (size_t i = 0U; i < root->segment_size; i++) {
+            segment->entries[i].param = &param_buffer[i * root->max_param_size];
+        }
+#endif
+    }
+    segment->next = NULL;
+    segment->read = 0U;
+    segment->write = 0U;
+    return segment;
+}
+
+static void release_segment(vivid_queue_pool_t *me, vivid_queue_segment_t *segment)
+{
+    vivid_queue_pool_t *root = me->root;
+    lock_pool(root);
+    segment->next = root->spare_segments;
+    root->spare_segments = segment;
+    if (me != root) {
+        me->bytes -= me->segment_bytes;
+    }
+    unlock_pool(root);
+}
+
 vivid_queue_t *vivid_queue_create(vivid_binding_t *binding, size_t size VIVID_PARAM_STATIC_ARGS(, size_t max_param_size))
+{
+    return vivid_queue_create_with_producers(binding, size, VIVID_QUEUE_MULTI_PRODUCER VIVID_PARAM_STATIC_ARGS(, max_param_size));
+}
+
+vivid_queue_t *vivid_queue_create_with_producers(vivid_binding_t *binding, size_t size, vivid_queue_producers_t producers VIVID_PARAM_STATIC_ARGS(, size_t max_param_size))
 {
     vivid_queue_t *me = (vivid_queue_t *)binding->calloc(binding, 1U, sizeof(*me));
     if (me == NULL) {
         return NULL;
     }
     me->binding = binding;
+#if VIVID_LOCKFREE
+    // The sequence numbers tell the full slots from the free ones, so all the slots are used:
+    if ((size == 0U) || (size > ((POSITION_MASK >> 1U) + 1U))) {
+        vivid_log_error(binding, "invalid queue size");
+        goto error;
+    }
+    // The positions wrap around, so the slots follow them as long as they are a power of 2 in number:
+    me->size = 1U;
+    while (me->size < size) {
+        me->size *= 2U;
+    }
+    me->single_producer = producers == VIVID_QUEUE_SINGLE_PRODUCER;
+#else
+    (void)producers;
     me->size = size + 1U;
-    me->entry_buffer = (vivid_queue_entry_t *)binding->calloc(binding, me->size, sizeof(*me->entry_buffer));
-    if (me->entry_buffer == NULL) {
+#endif
+    me->slots = (vivid_queue_slot_t *)binding->calloc(binding, me->size, sizeof(*me->slots));
+    if (me->slots == NULL) {
         goto error;
     }
 #if VIVID_LOCKFREE
-    me->ready_buffer = (atomic_bool *)binding->calloc(binding, me->size, sizeof(*me->ready_buffer));
-    if (me->ready_buffer == NULL) {
-        goto error;
+    for (size_t i = 0U; i < me->size; i++) {
+        atomic_init(&me->slots[i].sequence, i);
     }
+    atomic_flag_clear(&me->overflow_lock);
+    atomic_init(&me->write, 0U);
 #else
     me->binding_mutex = binding->create_mutex(binding);
     if (me->binding_mutex == NULL) {
@@ -60,7 +314,7 @@ vivid_queue_t *vivid_queue_create(vivid_binding_t *binding, size_t size VIVID_PA
         goto error;
     }
     for (size_t i = 0U; i < me->size; i++) {
-        me->entry_buffer[i].param = &me->param_buffer[i * max_param_size];
+        me->slots[i].entry.param = &me->param_buffer[i * max_param_size];
     }
 #endif
     return me;
@@ -74,18 +328,34 @@ void vivid_queue_destroy(vivid_queue_t *me)
     if (me == NULL) {
         return;
     }
+    while (me->overflow_head != NULL) {
+        vivid_queue_segment_t *segment = me->overflow_head;
+        me->overflow_head = segment->next;
+        release_segment(me->pool, segment);
+    }
 #if VIVID_PARAM_STATIC
     me->binding->free(me->param_buffer);
 #endif
-#if VIVID_LOCKFREE
-    me->binding->free(me->ready_buffer);
-#else
+#if !VIVID_LOCKFREE
     me->binding->destroy_mutex(me->binding_mutex);
 #endif
-    me->binding->free(me->entry_buffer);
+    me->binding->free(me->slots);
     me->binding->free(me);
 }
 
+bool vivid_queue_set_pool(vivid_queue_t *me, vivid_queue_pool_t *pool)
+{
+#if VIVID_PARAM_STATIC
+    if ((pool != NULL) && (pool->max_param_size < me->max_param_size)) {
+        vivid_log_error(me->binding, "queue param size too large for pool");
+        return false;
+    }
+#endif
+    me->pool = pool;
+    return true;
+}
+
+#if !VIVID_LOCKFREE
 static size_t inc_index(const vivid_queue_t *me, size_t index)
 {
     index++;
@@ -94,8 +364,137 @@ static size_t inc_index(const vivid_queue_t *me, size_t index)
     }
     return index;
 }
+#endif
+
+static void fill_entry(vivid_queue_entry_t *entry, vivid_event_id_t id, const char *name, vivid_time_t deadline VIVID_PARAM_ARGS(, VIVID_PARAM_STATIC_ARGS(const) void *param, VIVID_PARAM_STATIC_ARGS(size_t param_size) VIVID_PARAM_DYNAMIC_ARGS(vivid_param_destructor_t param_destructor)))
+{
+    entry->name = name;
+    entry->id = id;
+    entry->deadline = deadline;
+#if VIVID_PARAM
+#if VIVID_PARAM_DYNAMIC
+    entry->param = param;
+    entry->param_destructor = param_destructor;
+#else
+    memcpy(entry->param, param, param_size);
+    entry->param_size = param_size;
+#endif
+#endif
+}
+
+// Returns the next free entry of the segments, linking a new segment from the pool if needed:
+static vivid_queue_entry_t *get_overflow_entry(vivid_queue_t *me)
+{
+    vivid_queue_segment_t *tail = me->overflow_tail;
+    if ((tail == NULL) || (tail->write == me->pool->segment_size)) {
+        vivid_queue_segment_t *segment = take_segment(me->pool);
+        if (segment == NULL) {
+            return NULL;
+        }
+        if (tail == NULL) {
+            me->overflow_head = segment;
+        } else {
+            tail->next = segment;
+        }
+        me->overflow_tail = segment;
+        tail = segment;
+    }
+    return &tail->entries[tail->write];
+}
+
+// Queues the entry in the segments, once the slots are full. The entries of the slots are popped
+// first, and the segments are used until they are all popped, to keep the entries in order:
+static bool push_overflow(vivid_queue_t *me, bool log_full, vivid_event_id_t id, const char *name, vivid_time_t deadline VIVID_PARAM_ARGS(, VIVID_PARAM_STATIC_ARGS(const) void *param, VIVID_PARAM_STATIC_ARGS(size_t param_size) VIVID_PARAM_DYNAMIC_ARGS(vivid_param_destructor_t param_destructor)))
+{
+#if VIVID_LOCKFREE
+    lock_spin(&me->overflow_lock);
+    (void)atomic_fetch_or(&me->write, SPILLED);
+#endif
+    vivid_queue_entry_t *entry = get_overflow_entry(me);
+    if (entry == NULL) {
+#if VIVID_LOCKFREE
+        // Let the producers claim the slots again, unless other entries are already in the segments:
+        if (me->overflow_head == NULL) {
+            (void)atomic_fetch_and(&me->write, POSITION_MASK);
+        }
+        unlock_spin(&me->overflow_lock);
+#endif
+        if (log_full) {
+            vivid_log_error(me->binding, "queue full");
+        }
+        return false;
+    }
+    fill_entry(entry, id, name, deadline VIVID_PARAM_ARGS(, param VIVID_PARAM_STATIC_ARGS(, param_size) VIVID_PARAM_DYNAMIC_ARGS(, param_destructor)));
+    me->overflow_tail->write++;
+#if VIVID_LOCKFREE
+    unlock_spin(&me->overflow_lock);
+#endif
+    return true;
+}
+
+// Pops the entry at the front of the segments, and gives the segment back to the pool once all its
+// entries are popped:
+static void pop_overflow(vivid_queue_t *me)
+{
+#if VIVID_LOCKFREE
+    lock_spin(&me->overflow_lock);
+#endif
+    vivid_queue_segment_t *segment = me->overflow_head;
+    segment->read++;
+    if (segment->read == segment->write) {
+        me->overflow_head = segment->next;
+        if (me->overflow_head == NULL) {
+            me->overflow_tail = NULL;
+#if VIVID_LOCKFREE
+            // Let the producers claim the slots again:
+            (void)atomic_fetch_and(&me->write, POSITION_MASK);
+#endif
+        }
+        release_segment(me->pool, segment);
+    }
+#if VIVID_LOCKFREE
+    unlock_spin(&me->overflow_lock);
+#endif
+}
+
+#if VIVID_LOCKFREE
+// Claims the slot of the next position, or returns NULL if it is still full, or if the entries are
+// queued in the segments of the pool:
+static vivid_queue_slot_t *claim_slot(vivid_queue_t *me, size_t *position)
+{
+    vivid_queue_slot_t *slot;
+    *position = atomic_load_explicit(&me->write, memory_order_relaxed);
+    if (me->single_producer) {
+        // Only this thread moves the position, so its slot is either free or still full:
+        slot = &me->slots[*position & (me->size - 1U)];
+        if (((*position & SPILLED) != 0U) || (atomic_load_explicit(&slot->sequence, memory_order_acquire) != *position)) {
+            return NULL;
+        }
+        atomic_store_explicit(&me->write, (*position + 1U) & POSITION_MASK, memory_order_relaxed);
+        return slot;
+    }
+    // With a single compare and swap unless another producer claims the slot first:
+    for (;;) {
+        if ((*position & SPILLED) != 0U) {
+            return NULL;
+        }
+        slot = &me->slots[*position & (me->size - 1U)];
+        size_t lag = (atomic_load_explicit(&slot->sequence, memory_order_acquire) - *position) & POSITION_MASK;
+        if (lag == 0U) {
+            if (atomic_compare_exchange_weak_explicit(&me->write, position, (*position + 1U) & POSITION_MASK, memory_order_relaxed, memory_order_relaxed)) {
+                return slot;
+            }
+        } else if (lag > (POSITION_MASK >> 1U)) {
+            // The slot still holds the entry of the previous lap:
+            return NULL;
+        } else {
+            *position = atomic_load_explicit(&me->write, memory_order_relaxed);
+        }
+    }
+}
+#endif
 
-bool vivid_queue_push(vivid_queue_t *me, const char *name VIVID_PARAM_ARGS(, VIVID_PARAM_STATIC_ARGS(const) void *param, VIVID_PARAM_STATIC_ARGS(size_t param_size) VIVID_PARAM_DYNAMIC_ARGS(vivid_param_destructor_t param_destructor)))
+static bool push(vivid_queue_t *me, bool log_full, vivid_event_id_t id, const char *name, vivid_time_t deadline VIVID_PARAM_ARGS(, VIVID_PARAM_STATIC_ARGS(const) void *param, VIVID_PARAM_STATIC_ARGS(size_t param_size) VIVID_PARAM_DYNAMIC_ARGS(vivid_param_destructor_t param_destructor)))
 {
 #if VIVID_PARAM_STATIC
     if (param_size > me->max_param_size) {
@@ -104,91 +503,226 @@ bool vivid_queue_push(vivid_queue_t *me, const char *name VIVID_PARAM_ARGS(, VIV
     }
 #endif
 
-    size_t index;
 #if VIVID_LOCKFREE
-    // Find the next available entry:
-    for (;;) {
-        index = atomic_load(&me->pending);
-        size_t new_pending = inc_index(me, index);
-        // If all entries are full:
-        if (new_pending == atomic_load(&me->read)) {
-            vivid_log_error(me->binding, "queue full");
-            return false;
+    size_t position;
+    vivid_queue_slot_t *slot = claim_slot(me, &position);
+    if (slot == NULL) {
+        if (me->pool != NULL) {
+            return push_overflow(me, log_full, id, name, deadline VIVID_PARAM_ARGS(, param VIVID_PARAM_STATIC_ARGS(, param_size) VIVID_PARAM_DYNAMIC_ARGS(, param_destructor)));
         }
-        // Try to set the new pending index:
-        if (atomic_compare_exchange_strong(&me->pending, &index, new_pending)) {
-            break; // Success
+        if (log_full) {
+            vivid_log_error(me->binding, "queue full");
         }
+        return false;
     }
+    vivid_queue_entry_t *entry = &slot->entry;
 #else
     // Lock the mutex and get the next write index:
     if (!me->binding->lock_mutex(me->binding_mutex)) {
         return false;
     }
-    index = me->write;
-    size_t new_write = inc_index(me, index);
-    // If all entries are full:
-    if (new_write == me->read) {
+    size_t new_write = inc_index(me, me->write);
+    // If all entries are full, or the segments are in use:
+    if ((new_write == me->read) || (me->overflow_head != NULL)) {
+        bool pushed = false;
+        if (me->pool != NULL) {
+            pushed = push_overflow(me, log_full, id, name, deadline VIVID_PARAM_ARGS(, param VIVID_PARAM_STATIC_ARGS(, param_size) VIVID_PARAM_DYNAMIC_ARGS(, param_destructor)));
+        } else if (log_full) {
+            vivid_log_error(me->binding, "queue full");
+        }
         me->binding->unlock_mutex(me->binding_mutex);
-        vivid_log_error(me->binding, "queue full");
-        return false;
+        return pushed;
     }
+    vivid_queue_entry_t *entry = &me->slots[me->write].entry;
 #endif
 
-    // Fill the entry:
-    vivid_queue_entry_t *entry = &me->entry_buffer[index];
-    entry->name = name;
-#if VIVID_PARAM
-#if VIVID_PARAM_DYNAMIC
-    entry->param = param;
-    entry->param_destructor = param_destructor;
+    fill_entry(entry, id, name, deadline VIVID_PARAM_ARGS(, param VIVID_PARAM_STATIC_ARGS(, param_size) VIVID_PARAM_DYNAMIC_ARGS(, param_destructor)));
+
+#if VIVID_LOCKFREE
+    // Publish the entry to the consumer:
+    atomic_store_explicit(&slot->sequence, (position + 1U) & POSITION_MASK, memory_order_release);
 #else
-    memcpy(entry->param, param, param_size);
-    entry->param_size = param_size;
+    // Update the write index and unlock the mutex:
+    me->slots[me->write].ready = true;
+    me->write = new_write;
+    me->binding->unlock_mutex(me->binding_mutex);
+#endif
+    return true;
+}
+
+bool vivid_queue_push(vivid_queue_t *me, vivid_event_id_t id, const char *name VIVID_PARAM_ARGS(, VIVID_PARAM_STATIC_ARGS(const) void *param, VIVID_PARAM_STATIC_ARGS(size_t param_size) VIVID_PARAM_DYNAMIC_ARGS(vivid_param_destructor_t param_destructor)))
+{
+    return push(me, true, id, name, 0 VIVID_PARAM_ARGS(, param VIVID_PARAM_STATIC_ARGS(, param_size) VIVID_PARAM_DYNAMIC_ARGS(, param_destructor)));
+}
+
+bool vivid_queue_try_push(vivid_queue_t *me, vivid_event_id_t id, const char *name, vivid_time_t deadline VIVID_PARAM_ARGS(, VIVID_PARAM_STATIC_ARGS(const) void *param, VIVID_PARAM_STATIC_ARGS(size_t param_size) VIVID_PARAM_DYNAMIC_ARGS(vivid_param_destructor_t param_destructor)))
+{
+    return push(me, false, id, name, deadline VIVID_PARAM_ARGS(, param VIVID_PARAM_STATIC_ARGS(, param_size) VIVID_PARAM_DYNAMIC_ARGS(, param_destructor)));
+}
+
+#if !VIVID_LOCKFREE
+vivid_event_id_t vivid_queue_push_replacing(vivid_queue_t *me, vivid_queue_replace_t replace, vivid_event_id_t id, const char *name, vivid_time_t deadline VIVID_PARAM_ARGS(, VIVID_PARAM_STATIC_ARGS(const) void *param, VIVID_PARAM_STATIC_ARGS(size_t param_size) VIVID_PARAM_DYNAMIC_ARGS(vivid_param_destructor_t param_destructor)))
+{
+#if VIVID_PARAM_STATIC
+    if (param_size > me->max_param_size) {
+        vivid_log_error(me->binding, "queue param size too large");
+        return VIVID_EVENT_ID_NONE;
+    }
 #endif
+    if (!me->binding->lock_mutex(me->binding_mutex)) {
+        return VIVID_EVENT_ID_NONE;
+    }
+    vivid_event_id_t replaced_id = VIVID_EVENT_ID_NONE;
+#if VIVID_PARAM_DYNAMIC
+    void *replaced_param = NULL;
+    vivid_param_destructor_t replaced_param_destructor = NULL;
+#endif
+    // The front may be in use by the consumer, so only the entries following it are replaced, and
+    // only while the segments of the pool are not in use, nor any entry reserved:
+    size_t first = inc_index(me, me->read);
+    if ((me->overflow_head == NULL) && (me->num_reserved == 0U) && (me->read != me->write) && (first != me->write)) {
+        vivid_queue_entry_t *entry = NULL;
+        if (replace == VIVID_QUEUE_REPLACE_OLDEST) {
+            // Move the entries following the oldest one up, and reuse it as the last one:
+            vivid_queue_entry_t oldest = me->slots[first].entry;
+            size_t index = first;
+            for (size_t next = inc_index(me, index); next != me->write; next = inc_index(me, next)) {
+                me->slots[index].entry = me->slots[next].entry;
+                index = next;
+            }
+            me->slots[index].entry = oldest;
+            entry = &me->slots[index].entry;
+        } else {
+            for (size_t index = first; index != me->write; index = inc_index(me, index)) {
+                if (me->slots[index].entry.id == id) {
+                    entry = &me->slots[index].entry;
+                }
+            }
+        }
+        if (entry != NULL) {
+            replaced_id = entry->id;
+#if VIVID_PARAM_DYNAMIC
+            replaced_param = entry->param;
+            replaced_param_destructor = entry->param_destructor;
+#endif
+            fill_entry(entry, id, name, deadline VIVID_PARAM_ARGS(, param VIVID_PARAM_STATIC_ARGS(, param_size) VIVID_PARAM_DYNAMIC_ARGS(, param_destructor)));
+        }
+    }
+    me->binding->unlock_mutex(me->binding_mutex);
+#if VIVID_PARAM_DYNAMIC
+    if (replaced_param_destructor != NULL) {
+        replaced_param_destructor(replaced_param);
+    }
+#endif
+    return replaced_id;
+}
 #endif
 
+#if VIVID_PARAM_STATIC
+void *vivid_queue_reserve(vivid_queue_t *me, size_t param_size, vivid_queue_reservation_t *reservation)
+{
+    if (param_size > me->max_param_size) {
+        vivid_log_error(me->binding, "queue param size too large");
+        return NULL;
+    }
 #if VIVID_LOCKFREE
-    // Set the ready flag:
-    atomic_bool *ready = &me->ready_buffer[index];
-    bool ready_value = true;
-    atomic_store(ready, ready_value);
-    // Increment the write index for each 'ready' flag that can be changed from true to false:
-    index = atomic_load(&me->write);
-    for (;;) {
-        ready = &me->ready_buffer[index];
-        if (!atomic_compare_exchange_strong(ready, &ready_value, false)) {
-            break; // Either the entry is not ready, or another thread has beaten us to it
-        }
-        index = inc_index(me, index);
-        atomic_store(&me->write, index);
+    vivid_queue_slot_t *slot = claim_slot(me, &reservation->position);
+    if (slot == NULL) {
+        return NULL;
     }
 #else
-    // Update the write index and unlock the mutex:
+    if (!me->binding->lock_mutex(me->binding_mutex)) {
+        return NULL;
+    }
+    size_t new_write = inc_index(me, me->write);
+    // The entries queued in the segments meanwhile would be popped after the reserved one:
+    if ((new_write == me->read) || (me->overflow_head != NULL)) {
+        me->binding->unlock_mutex(me->binding_mutex);
+        return NULL;
+    }
+    vivid_queue_slot_t *slot = &me->slots[me->write];
+    slot->ready = false;
+    reservation->position = me->write;
     me->write = new_write;
+    me->num_reserved++;
+    me->binding->unlock_mutex(me->binding_mutex);
+#endif
+    // The entry is only seen by this producer until committed:
+    reservation->entry = &slot->entry;
+    reservation->entry->param_size = param_size;
+    return reservation->entry->param;
+}
+
+void vivid_queue_commit(vivid_queue_t *me, const vivid_queue_reservation_t *reservation, vivid_event_id_t id, const char *name, vivid_time_t deadline)
+{
+    vivid_queue_entry_t *entry = reservation->entry;
+    entry->name = name;
+    entry->id = id;
+    entry->deadline = deadline;
+#if VIVID_LOCKFREE
+    atomic_store_explicit(&me->slots[reservation->position & (me->size - 1U)].sequence, (reservation->position + 1U) & POSITION_MASK, memory_order_release);
+#else
+    (void)me->binding->lock_mutex(me->binding_mutex);
+    me->slots[reservation->position].ready = true;
+    me->num_reserved--;
     me->binding->unlock_mutex(me->binding_mutex);
 #endif
-    return true;
 }
+#endif
+
+#if VIVID_LOCKFREE
+static bool is_slot_full(const vivid_queue_t *me)
+{
+    const vivid_queue_slot_t *slot = &me->slots[me->read & (me->size - 1U)];
+    return atomic_load_explicit(&slot->sequence, memory_order_acquire) == ((me->read + 1U) & POSITION_MASK);
+}
+#endif
 
 bool vivid_queue_empty(vivid_queue_t *me)
 {
 #if VIVID_LOCKFREE
-    return atomic_load(&me->read) == atomic_load(&me->write);
+    if (is_slot_full(me)) {
+        return false;
+    }
+    if (me->pool == NULL) {
+        return true;
+    }
+    // The segments are only popped once the slots claimed before them are:
+    size_t write = atomic_load_explicit(&me->write, memory_order_acquire);
+    if (((write & SPILLED) == 0U) || ((write & POSITION_MASK) != me->read)) {
+        return true;
+    }
+    lock_spin(&me->overflow_lock);
+    bool empty = me->overflow_head == NULL;
+    unlock_spin(&me->overflow_lock);
+    return empty;
 #else
     (void)me->binding->lock_mutex(me->binding_mutex);
-    bool empty = me->read == me->write;
+    bool empty = (me->read == me->write) ? (me->overflow_head == NULL) : !me->slots[me->read].ready;
     me->binding->unlock_mutex(me->binding_mutex);
     return empty;
 #endif
 }
 
+// Once the queue is not empty, the entries of the slots are popped first. No slot can be claimed
+// while the entries of the segments are popped, so the front stays the same until popped:
 const vivid_queue_entry_t *vivid_queue_front(const vivid_queue_t *me)
 {
 #if VIVID_LOCKFREE
-    return &me->entry_buffer[atomic_load(&me->read)];
+    if ((me->pool != NULL) && !is_slot_full(me)) {
+        return &me->overflow_head->entries[me->overflow_head->read];
+    }
+    return &me->slots[me->read & (me->size - 1U)].entry;
 #else
-    return &me->entry_buffer[me->read];
+    if (me->pool != NULL) {
+        (void)me->binding->lock_mutex(me->binding_mutex);
+        bool overflow = me->read == me->write;
+        me->binding->unlock_mutex(me->binding_mutex);
+        if (overflow) {
+            return &me->overflow_head->entries[me->overflow_head->read];
+        }
+    }
+    return &me->slots[me->read].entry;
 #endif
 }
 
@@ -201,10 +735,20 @@ void vivid_queue_pop(vivid_queue_t *me)
     }
 #endif
 #if VIVID_LOCKFREE
-    atomic_store(&me->read, inc_index(me, atomic_load(&me->read)));
+    if ((me->pool != NULL) && !is_slot_full(me)) {
+        pop_overflow(me);
+        return;
+    }
+    // Free the slot for the producers of the next lap:
+    atomic_store_explicit(&me->slots[me->read & (me->size - 1U)].sequence, (me->read + me->size) & POSITION_MASK, memory_order_release);
+    me->read = (me->read + 1U) & POSITION_MASK;
 #else
     (void)me->binding->lock_mutex(me->binding_mutex);
-    me->read = inc_index(me, me->read);
+    if (me->read == me->write) {
+        pop_overflow(me);
+    } else {
+        me->read = inc_index(me, me->read);
+    }
     me->binding->unlock_mutex(me->binding_mutex);
 #endif
 }
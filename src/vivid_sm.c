@@ -2,10 +2,7 @@
 // SPDX-License-Identifier: Apache-2.0.
 
 #include "vivid_priv.h"
-
-#if VIVID_LOG
 #include <string.h>
-#endif
 
 //--------------------------------------------------------------------------------------------------
 // Options
@@ -13,257 +10,1127 @@
 #ifndef VIVID_LOG_BUFFER_SIZE
 #define VIVID_LOG_BUFFER_SIZE 256U
 #endif
+
+// Default number of events handled per wakeup, see vivid_set_event_budget():
+#ifndef VIVID_EVENT_BUDGET
+#define VIVID_EVENT_BUDGET 16U
+#endif
+
+// Minimum time between two reports of the events lost or dropped, in seconds:
+#ifndef VIVID_OVERLOAD_REPORT_TIME
+#define VIVID_OVERLOAD_REPORT_TIME 1.0
+#endif
+
+// Time slept by the producers between two attempts with VIVID_OVERLOAD_BLOCK, in seconds:
+#ifndef VIVID_OVERLOAD_SLEEP_TIME
+#define VIVID_OVERLOAD_SLEEP_TIME 0.001
+#endif
 //--------------------------------------------------------------------------------------------------
 
-typedef struct {
+// Timer of a state function, shared by all the instances of a class:
+struct vivid_timer_info {
+    const vivid_event_t *event;
+    const vivid_timer_info_t *next;
+};
+
+// Binding timer of an instance, held by one of its timers while the state of the timer is active,
+// and kept as a spare otherwise, see acquire_timer():
+struct vivid_timer_slot {
     vivid_sm_t *vsm;
-    const char *name;
+    vivid_sm_timer_t *STATE_TYPE_QUALIFIER timer; // NULL while spare, so that late expiries are dropped
     vivid_binding_timer_t *binding_timer;
+    vivid_timer_slot_t *next_spare;
+};
+
+struct vivid_sm_timer {
+    const vivid_timer_info_t *info;
+    vivid_timer_slot_t *slot; // NULL unless the state of the timer is active
     vivid_time_t due_time;
     bool active;
-} vivid_sm_timer_t;
+};
 
-static const char *const m_init_string = "init";
-static const char *const m_entry_string = "entry";
-static const char *const m_exit_string = "exit";
-static const char *const m_jump_string = "jump";
+// Steps of the tree walks, in the order they are taken:
+typedef enum {
+    WALK_STEP_NODE,
+    WALK_STEP_CLEAR_STATE,
+    WALK_STEP_CHILDREN,
+    WALK_STEP_EXIT,
+    WALK_STEP_SIBLINGS
+} walk_step_t;
+
+static const vivid_event_t m_init_event = { .name = "init", .id = VIVID_EVENT_ID_INIT };
+static const vivid_event_t m_entry_event = { .name = "entry", .id = VIVID_EVENT_ID_ENTRY };
+static const vivid_event_t m_exit_event = { .name = "exit", .id = VIVID_EVENT_ID_EXIT };
+static const vivid_event_t m_jump_event = { .name = "jump", .id = VIVID_EVENT_ID_JUMP };
+static vivid_event_id_t m_next_event_id = VIVID_EVENT_ID_FIRST;
 #if VIVID_LOG
 static const char *const m_true_string = "true";
 static const char *const m_false_string = "false";
 #endif
 
-void vivid_call_node(vivid_node_t *node, const char *event_string)
+void vivid_call_node(vivid_node_t *node, const vivid_event_t *event)
 {
-    vivid_queue_entry_t event = { 0 };
-    event.name = event_string;
-    node->current_event = &event;
-    node->fn(node, node->vsm->app);
-    node->current_event = NULL;
+    vivid_sm_t *me = node->vsm;
+    vivid_queue_entry_t entry = { 0 };
+    entry.name = event->name;
+    entry.id = event->id;
+    // Calls are nested for the sub-states during init, so restore the event of the caller:
+    const vivid_queue_entry_t *caller_event = me->current_event;
+    me->current_event = &entry;
+    node->info->fn(node, me->app);
+    me->current_event = caller_event;
 }
 
-static vivid_node_t *walk_init(vivid_sm_t *me, vivid_state_t fn, size_t depth VIVID_LOG_ARGS(, const char *name))
+static void add_to_event_set(uint32_t *set, vivid_event_id_t id)
 {
-    vivid_node_t **value = (vivid_node_t **)vivid_map_set(me->node_map, (size_t)fn);
-    if (value == NULL) {
-        return NULL;
+    set[id / 32U] |= (uint32_t)1U << (id % 32U);
+}
+
+static bool is_in_event_set(const vivid_sm_class_t *me, const uint32_t *set, vivid_event_id_t id)
+{
+    size_t index = id / 32U;
+    return (index < me->num_event_words) && ((set[index] & ((uint32_t)1U << (id % 32U))) != 0U);
+}
+
+// Marks a coalesced event as queued, and returns false if it already was:
+static bool set_pending(vivid_sm_t *me, vivid_event_id_t id)
+{
+    uint32_t mask = (uint32_t)1U << (id % 32U);
+#if VIVID_LOCKFREE
+    return (atomic_fetch_or(&me->pending_events[id / 32U], mask) & mask) == 0U;
+#else
+    (void)me->binding->lock_mutex(me->binding_mutex);
+    bool was_pending = (me->pending_events[id / 32U] & mask) != 0U;
+    me->pending_events[id / 32U] |= mask;
+    me->binding->unlock_mutex(me->binding_mutex);
+    return !was_pending;
+#endif
+}
+
+static void clear_pending(vivid_sm_t *me, vivid_event_id_t id)
+{
+    uint32_t mask = (uint32_t)1U << (id % 32U);
+#if VIVID_LOCKFREE
+    (void)atomic_fetch_and(&me->pending_events[id / 32U], ~mask);
+#else
+    (void)me->binding->lock_mutex(me->binding_mutex);
+    me->pending_events[id / 32U] &= ~mask;
+    me->binding->unlock_mutex(me->binding_mutex);
+#endif
+}
+
+static vivid_node_index_t get_index(const vivid_node_t *node)
+{
+    return (vivid_node_index_t)(node - node->vsm->nodes);
+}
+
+static uint32_t *get_handlers(const vivid_sm_class_t *me, vivid_node_index_t index)
+{
+    return &me->handlers[2U * index * me->num_event_words];
+}
+
+static uint32_t *get_subtree_handlers(const vivid_sm_class_t *me, vivid_node_index_t index)
+{
+    return &me->handlers[((2U * index) + 1U) * me->num_event_words];
+}
+
+static void add_handler(vivid_node_t *node, vivid_event_id_t id)
+{
+    add_to_event_set(get_handlers(node->vsm->sm_class, get_index(node)), id);
+}
+
+// Returns the topology of a node, to record it during init:
+static vivid_node_info_t *get_init_info(const vivid_node_t *node)
+{
+    return &node->vsm->sm_class->recorded_nodes[get_index(node)];
+}
+
+static size_t hash_state(vivid_state_t fn)
+{
+    size_t key = (size_t)fn;
+    return key ^ (key >> 4U) ^ (key >> 12U);
+}
+
+static vivid_node_index_t *find_node_table_entry(const vivid_sm_class_t *me, vivid_state_t fn)
+{
+    size_t index = hash_state(fn) & me->node_table_mask;
+    while ((me->node_table[index] != VIVID_NODE_INDEX_NONE) && (me->nodes[me->node_table[index]].fn != fn)) {
+        index = (index + 1U) & me->node_table_mask;
     }
-    if (*value != NULL) {
-        VIVID_LOG_ERROR(me->log, "sub-state defined more than once: %s", name);
+    return &me->node_table[index];
+}
+
+vivid_node_t *vivid_find_node(vivid_sm_t *me, vivid_state_t fn)
+{
+    return vivid_get_node(me, *find_node_table_entry(me->sm_class, fn));
+}
+
+// Node of the sizing pass, linked to its parent to detect sub-states including themselves:
+typedef struct vivid_size_node {
+    vivid_node_t node;
+    vivid_node_info_t info;
+    const struct vivid_size_node *parent;
+} vivid_size_node_t;
+
+static bool walk_size(vivid_sm_t *me, vivid_state_t fn, const vivid_size_node_t *parent VIVID_LOG_ARGS(, const char *name))
+{
+    vivid_sm_class_t *sm_class = me->sm_class;
+    for (const vivid_size_node_t *ancestor = parent; ancestor != NULL; ancestor = ancestor->parent) {
+        if (ancestor->info.fn == fn) {
+            VIVID_LOG_ERROR(me->log, "sub-state defined more than once: %s", name);
+            return false;
+        }
+    }
+    if (sm_class->num_nodes == VIVID_NODE_INDEX_NONE) {
+        VIVID_LOG_ERROR(me->log, "%s | init | too many states: %s", me->name, name);
+        return false;
+    }
+    sm_class->num_nodes++;
+    vivid_size_node_t size_node = { 0 };
+    size_node.node.vsm = me;
+    size_node.node.info = &size_node.info;
+#if VIVID_LOG
+    size_node.info.name = name;
+#endif
+    size_node.info.fn = fn;
+    size_node.info.depth = (parent != NULL) ? (vivid_node_index_t)(parent->info.depth + 1U) : 0U;
+    size_node.parent = parent;
+    if (size_node.info.depth > sm_class->max_depth) {
+        sm_class->max_depth = size_node.info.depth;
+    }
+    vivid_call_node(&size_node.node, &m_init_event); // Note: this function is recursive via this call
+    return !me->init_error;
+}
+
+static bool create_class_arena(vivid_sm_class_t *me, bool record_nodes)
+{
+    size_t table_size = 1U;
+    while (table_size < (2U * me->num_nodes)) {
+        table_size *= 2U;
+    }
+    // All the event ids handled by the state machine are assigned at this point:
+    me->num_event_words = (m_next_event_id / 32U) + 1U;
+    size_t num_words = ((2U * me->num_nodes) + 1U) * me->num_event_words;
+    // Each part is aligned, as it is placed after parts with larger or equal alignment:
+    size_t timers_size = me->num_timers * sizeof(*me->timers);
+    size_t node_timers_size = me->num_nodes * sizeof(*me->node_timers);
+    size_t nodes_size = record_nodes ? (me->num_nodes * sizeof(*me->recorded_nodes)) : 0U;
+    size_t words_size = num_words * sizeof(uint32_t);
+    size_t table_bytes = table_size * sizeof(*me->node_table);
+    size_t indices_size = 0U;
+#if VIVID_DISPATCH
+    if (me->dispatch != NULL) {
+        indices_size = me->num_event_words * 32U * sizeof(*me->event_indices);
+    }
+#endif
+    uint8_t *arena = (uint8_t *)me->binding->calloc(me->binding, 1U, timers_size + node_timers_size + nodes_size + words_size + table_bytes + indices_size);
+    if (arena == NULL) {
+        return false;
+    }
+    me->arena = arena;
+    me->timers = (vivid_timer_info_t *)arena;
+    me->node_timers = (const vivid_timer_info_t **)(arena += timers_size);
+    if (record_nodes) {
+        me->recorded_nodes = (vivid_node_info_t *)(arena + node_timers_size);
+        me->nodes = me->recorded_nodes;
+    }
+    me->handlers = (uint32_t *)(arena += node_timers_size + nodes_size);
+    me->node_table = (vivid_node_index_t *)(arena += words_size);
+    me->node_table_mask = table_size - 1U;
+    for (size_t i = 0U; i < table_size; i++) {
+        me->node_table[i] = VIVID_NODE_INDEX_NONE;
+    }
+#if VIVID_DISPATCH
+    if (me->dispatch != NULL) {
+        me->event_indices = (uint16_t *)(arena + table_bytes);
+        for (size_t i = 0U; i < (me->num_event_words * 32U); i++) {
+            me->event_indices[i] = UINT16_MAX;
+        }
+    }
+#endif
+    me->coalesced_events = &me->handlers[2U * me->num_nodes * me->num_event_words];
+    return true;
+}
+
+// Completes the subtree handlers of a node, once those of its children are complete:
+static void collect_subtree_handlers(vivid_sm_class_t *me, vivid_node_index_t index)
+{
+    uint32_t *subtree_handlers = get_subtree_handlers(me, index);
+    const uint32_t *handlers = get_handlers(me, index);
+    for (size_t i = 0U; i < me->num_event_words; i++) {
+        subtree_handlers[i] = handlers[i];
+    }
+    for (vivid_node_index_t child = me->nodes[index].children; child != VIVID_NODE_INDEX_NONE; child = me->nodes[child].siblings) {
+        const uint32_t *child_handlers = get_subtree_handlers(me, child);
+        for (size_t i = 0U; i < me->num_event_words; i++) {
+            subtree_handlers[i] |= child_handlers[i];
+        }
+    }
+}
+
+static bool create_arena(vivid_sm_t *me, size_t num_lanes)
+{
+    const vivid_sm_class_t *sm_class = me->sm_class;
+    // The entry and exit walks take one frame per level:
+    me->walk_stack_size = sm_class->max_depth + 1U;
+    // Each part is aligned, as it is placed after parts with larger or equal alignment:
+    size_t timers_size = sm_class->num_timers * sizeof(*me->timers);
+    size_t queues_size = num_lanes * sizeof(*me->event_queues);
+    size_t nodes_size = sm_class->num_nodes * sizeof(*me->nodes);
+    size_t stack_size = me->walk_stack_size * sizeof(*me->walk_stack);
+    size_t pending_size = sm_class->num_event_words * sizeof(*me->pending_events);
+    size_t active_size = sm_class->num_nodes * sizeof(*me->active_nodes);
+    size_t jump_size = 2U * sm_class->num_nodes * sizeof(*me->jump_nodes);
+    uint8_t *arena = (uint8_t *)me->binding->calloc(me->binding, 1U, timers_size + queues_size + nodes_size + stack_size + pending_size + active_size + jump_size);
+    if (arena == NULL) {
+        return false;
+    }
+    me->arena = arena;
+    me->timers = (vivid_sm_timer_t *)arena;
+    me->event_queues = (vivid_queue_t **)(arena += timers_size);
+    me->num_lanes = num_lanes;
+    me->nodes = (vivid_node_t *)(arena += queues_size);
+    me->walk_stack = (vivid_walk_frame_t *)(arena += nodes_size);
+    me->pending_events = (uint32_t STATE_TYPE_QUALIFIER *)(arena += stack_size);
+    me->active_nodes = (vivid_node_index_t *)(arena += pending_size);
+    me->jump_nodes = (vivid_node_index_t *)(arena += active_size);
+    for (size_t i = 0U; i < sm_class->num_timers; i++) {
+        me->timers[i].info = &sm_class->timers[i];
+    }
+    for (size_t i = 0U; i < sm_class->num_nodes; i++) {
+        me->nodes[i].vsm = me;
+        me->nodes[i].info = &sm_class->nodes[i];
+        me->nodes[i].state = VIVID_NODE_INDEX_NONE;
+    }
+    return true;
+}
+
+static vivid_node_t *walk_init(vivid_sm_t *me, vivid_state_t fn, vivid_node_index_t depth VIVID_LOG_ARGS(, const char *name))
+{
+    vivid_sm_class_t *sm_class = me->sm_class;
+    if (me->next_node == sm_class->num_nodes) {
+        VIVID_LOG_ERROR(me->log, "%s | init | %s | more states than when sizing", me->name, name);
         return NULL;
     }
-    vivid_node_t *node = (vivid_node_t *)me->binding->calloc(me->binding, 1U, sizeof(*node));
-    if (node == NULL) {
+    vivid_node_index_t *entry = find_node_table_entry(sm_class, fn);
+    if (*entry != VIVID_NODE_INDEX_NONE) {
+        VIVID_LOG_ERROR(me->log, "sub-state defined more than once: %s", name);
         return NULL;
     }
-    *value = node;
-    node->vsm = me;
+    *entry = (vivid_node_index_t)me->next_node++;
+    vivid_node_t *node = &me->nodes[*entry];
+    vivid_node_info_t *info = &sm_class->recorded_nodes[*entry];
 #if VIVID_LOG
-    node->name = name;
+    info->name = name;
 #endif
-    node->fn = fn;
-    node->depth = depth;
-    vivid_call_node(node, m_init_string); // Note: this function is recursive via this call
+    info->fn = fn;
+    info->parent = VIVID_NODE_INDEX_NONE;
+    info->children = VIVID_NODE_INDEX_NONE;
+    info->siblings = VIVID_NODE_INDEX_NONE;
+    info->default_child = VIVID_NODE_INDEX_NONE;
+    info->depth = depth;
+    vivid_call_node(node, &m_init_event); // Note: this function is recursive via this call
     if (me->init_error) {
         return NULL;
     }
-    if ((node->children != NULL) && !node->parallel_children && (node->default_child == NULL)) {
+    info->subtree_end = (vivid_node_index_t)me->next_node;
+    // The children are fully initialized at this point:
+    collect_subtree_handlers(sm_class, get_index(node));
+    if ((info->children != VIVID_NODE_INDEX_NONE) && !info->parallel_children && (info->default_child == VIVID_NODE_INDEX_NONE)) {
         VIVID_LOG_ERROR(me->log, "%s | %s | undefined default sub-state", me->name, name);
         return NULL;
     }
     return node;
 }
 
-static void set_state(vivid_node_t *node, vivid_node_t *value)
+static bool register_event(vivid_sm_t *me, vivid_event_t *event)
+{
+    if (event->id != VIVID_EVENT_ID_NONE) {
+        return true;
+    }
+    if (m_next_event_id == UINT16_MAX) {
+        VIVID_LOG_ERROR(me->log, "%s | init | too many events: %s", me->name, event->name);
+        return false;
+    }
+    event->id = m_next_event_id++;
+    return true;
+}
+
+static void set_state(vivid_node_t *node, const vivid_node_t *value)
 {
     vivid_sm_t *me = node->vsm;
-    // Ignore pseudo-state changes:
-    if ((value != NULL) && ((value->type == VIVID_NODE_TYPE_STATE) || (value->type == VIVID_NODE_TYPE_STATE_FINAL))) {
-        me->transition.state_change = true;
+    vivid_node_index_t index = VIVID_NODE_INDEX_NONE;
+    if (value != NULL) {
+        index = get_index(value);
+        // Ignore pseudo-state changes:
+        if ((value->info->type == VIVID_NODE_TYPE_STATE) || (value->info->type == VIVID_NODE_TYPE_STATE_FINAL)) {
+            me->transition.state_change = true;
+        }
     }
 #if VIVID_LOCKFREE
-    atomic_store(&node->state, value);
+    atomic_store(&node->state, index);
 #else
     (void)me->binding->lock_mutex(me->binding_mutex);
-    node->state = value;
+    node->state = index;
     me->binding->unlock_mutex(me->binding_mutex);
 #endif
 }
 
 static vivid_node_t *get_state(vivid_node_t *node)
 {
+    vivid_sm_t *me = node->vsm;
 #if VIVID_LOCKFREE
-    return atomic_load(&node->state);
+    return vivid_get_node(me, atomic_load(&node->state));
 #else
-    vivid_sm_t *me = node->vsm;
     (void)me->binding->lock_mutex(me->binding_mutex);
-    vivid_node_t *value = node->state;
+    vivid_node_index_t index = node->state;
     me->binding->unlock_mutex(me->binding_mutex);
-    return value;
+    return vivid_get_node(me, index);
 #endif
 }
 
+static bool has_parallel_siblings(const vivid_node_t *node)
+{
+    const vivid_node_info_t *info = node->info;
+    return (info->parent != VIVID_NODE_INDEX_NONE) && node->vsm->sm_class->nodes[info->parent].parallel_children && (info->siblings != VIVID_NODE_INDEX_NONE);
+}
+
+// Returns the position of the first active node with an index at or after the given one:
+static size_t find_active_node(const vivid_sm_t *me, vivid_node_index_t index)
+{
+    size_t low = 0U;
+    size_t high = me->num_active_nodes;
+    while (low < high) {
+        size_t middle = low + ((high - low) / 2U);
+        if (me->active_nodes[middle] < index) {
+            low = middle + 1U;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static void enter_node(vivid_node_t *node)
+{
+    vivid_sm_t *me = node->vsm;
+    vivid_node_index_t index = get_index(node);
+    if (!node->active) {
+        size_t position = find_active_node(me, index);
+        memmove(&me->active_nodes[position + 1U], &me->active_nodes[position], (me->num_active_nodes - position) * sizeof(*me->active_nodes));
+        me->active_nodes[position] = index;
+        me->num_active_nodes++;
+        node->active = true;
+    }
+    // Collect the nodes with jumps to evaluate, once each:
+    if (!node->jump_pending && is_in_event_set(me->sm_class, get_handlers(me->sm_class, index), VIVID_EVENT_ID_JUMP)) {
+        node->jump_pending = true;
+        me->jump_nodes[me->num_jump_nodes++] = index;
+    }
+    node->entered = true;
+    me->nodes_entered = true;
+    vivid_call_node(node, &m_entry_event);
+}
+
+static void exit_node(vivid_node_t *node)
+{
+    vivid_sm_t *me = node->vsm;
+    vivid_node_index_t index = get_index(node);
+    vivid_call_node(node, &m_exit_event);
+    if (node->active) {
+        size_t position = find_active_node(me, index);
+        me->num_active_nodes--;
+        memmove(&me->active_nodes[position], &me->active_nodes[position + 1U], (me->num_active_nodes - position) * sizeof(*me->active_nodes));
+        node->active = false;
+    }
+}
+
+static void push_frame(vivid_walk_frame_t *stack, size_t *top, vivid_node_t *node)
+{
+    vivid_walk_frame_t *frame = &stack[(*top)++];
+    frame->node = node;
+    frame->step = WALK_STEP_NODE;
+}
+
+// Continues a walk with the next parallel sibling of the frame's node, if any. The sibling takes
+// the place of the node, as nothing remains to be done for it:
+static void walk_siblings(vivid_walk_frame_t *stack, size_t *top)
+{
+    vivid_walk_frame_t *frame = &stack[*top - 1U];
+    if (has_parallel_siblings(frame->node)) {
+        frame->node = &frame->node->vsm->nodes[frame->node->info->siblings];
+        frame->step = WALK_STEP_NODE;
+    } else {
+        (*top)--;
+    }
+}
+
+// The walks keep the top of the stack in a local variable, and publish it before calling the state
+// functions, which may start nested walks above it.
+
 static void walk_entry_down(vivid_node_t *node, const vivid_node_t *except)
 {
-    if (node != except) {
-        vivid_call_node(node, m_entry_string);
-        if (node->default_child != NULL) {
-            set_state(node, node->default_child);
-            walk_entry_down(node->default_child, NULL);
+    vivid_sm_t *me = node->vsm;
+    vivid_walk_frame_t *stack = me->walk_stack;
+    size_t base = me->walk_stack_top;
+    size_t top = base;
+    push_frame(stack, &top, node);
+    while (top > base) {
+        vivid_walk_frame_t *frame = &stack[top - 1U];
+        node = frame->node;
+        if (frame->step == WALK_STEP_NODE) {
+            frame->step = WALK_STEP_SIBLINGS;
+            // Only the first node and its siblings can be the exception, as sub-trees are entered fully:
+            if ((node != except) || (top != (base + 1U))) {
+                frame->step = WALK_STEP_CHILDREN;
+                me->walk_stack_top = top;
+                enter_node(node);
+                if (node->info->default_child != VIVID_NODE_INDEX_NONE) {
+                    vivid_node_t *default_child = &me->nodes[node->info->default_child];
+                    set_state(node, default_child);
+                    push_frame(stack, &top, default_child);
+                    continue;
+                }
+            }
         }
-        if (node->parallel_children) {
-            walk_entry_down(node->children, NULL);
+        if (frame->step == WALK_STEP_CHILDREN) {
+            frame->step = WALK_STEP_SIBLINGS;
+            if (node->info->parallel_children) {
+                push_frame(stack, &top, &me->nodes[node->info->children]);
+                continue;
+            }
         }
+        walk_siblings(stack, &top);
     }
-    if ((node->parent != NULL) && node->parent->parallel_children && (node->siblings != NULL)) {
-        walk_entry_down(node->siblings, except);
+    me->walk_stack_top = base;
+}
+
+static void walk_exit_down(vivid_node_t *node, const vivid_node_t *except)
+{
+    vivid_sm_t *me = node->vsm;
+    vivid_walk_frame_t *stack = me->walk_stack;
+    size_t base = me->walk_stack_top;
+    size_t top = base;
+    push_frame(stack, &top, node);
+    while (top > base) {
+        vivid_walk_frame_t *frame = &stack[top - 1U];
+        node = frame->node;
+        if (frame->step == WALK_STEP_NODE) {
+            frame->step = WALK_STEP_SIBLINGS;
+            // Only the first node and its siblings can be the exception, as sub-trees are exited fully:
+            if ((node != except) || (top != (base + 1U))) {
+                frame->step = WALK_STEP_CHILDREN;
+                vivid_node_t *state = get_state(node);
+                if (state != NULL) {
+                    frame->step = WALK_STEP_CLEAR_STATE;
+                    push_frame(stack, &top, state);
+                    continue;
+                }
+            }
+        }
+        if (frame->step == WALK_STEP_CLEAR_STATE) {
+            frame->step = WALK_STEP_CHILDREN;
+            set_state(node, NULL);
+        }
+        if (frame->step == WALK_STEP_CHILDREN) {
+            frame->step = WALK_STEP_EXIT;
+            if (node->info->parallel_children) {
+                push_frame(stack, &top, &me->nodes[node->info->children]);
+                continue;
+            }
+        }
+        if (frame->step == WALK_STEP_EXIT) {
+            me->walk_stack_top = top;
+            exit_node(node);
+        }
+        walk_siblings(stack, &top);
     }
+    me->walk_stack_top = base;
 }
 
-static void walk_entry_up(vivid_node_t *node, const vivid_node_t *ancestor, vivid_node_t *branch, bool enter_ancestor)
+static void exit_path(const vivid_transition_path_t *path)
 {
-    if ((node->parent != NULL) && (node != ancestor)) {
-        walk_entry_up(node->parent, ancestor, node, enter_ancestor);
+    const vivid_node_t *branch = NULL;
+    for (size_t i = 0U; i < path->num_exits; i++) {
+        vivid_node_t *node = path->path[i];
+        if (branch == NULL) {
+            vivid_node_t *state = get_state(node);
+            if (state != NULL) {
+                walk_exit_down(state, NULL);
+            }
+        }
+        if (node->info->parallel_children) {
+            walk_exit_down(&node->vsm->nodes[node->info->children], branch);
+        }
+        set_state(node, NULL);
+        if ((node != path->ancestor) || path->reenter_ancestor) {
+            exit_node(node);
+        }
+        branch = node;
     }
-    if (branch != NULL) {
-        set_state(node, branch);
-        if ((node != ancestor) || enter_ancestor) {
-            vivid_call_node(node, m_entry_string);
+}
+
+static void entry_path(const vivid_transition_path_t *path)
+{
+    vivid_node_t *const *entries = &path->path[path->num_exits];
+    for (size_t i = 0U; (i + 1U) < path->num_entries; i++) {
+        vivid_node_t *node = entries[i];
+        vivid_node_t *branch = entries[i + 1U];
+        // The regions of a parallel node are all active, so none of them is its state:
+        if (!node->info->parallel_children) {
+            set_state(node, branch);
+        }
+        if ((node != path->ancestor) || path->reenter_ancestor) {
+            enter_node(node);
         }
-        if (node->parallel_children) {
-            walk_entry_down(node->children, branch);
+        if (node->info->parallel_children) {
+            walk_entry_down(&node->vsm->nodes[node->info->children], branch);
         }
+    }
+    walk_entry_down(entries[path->num_entries - 1U], NULL);
+}
+
+// Calls the state function of a node for an event, or the generated dispatcher when it handles the event:
+static void call_state(vivid_sm_t *me, vivid_node_t *node, vivid_event_id_t id)
+{
+#if VIVID_DISPATCH
+    const vivid_sm_class_t *sm_class = me->sm_class;
+    // The timer events are not numbered, as they are local to the state functions:
+    if ((sm_class->dispatch != NULL) && (sm_class->event_indices[id] != UINT16_MAX)) {
+        sm_class->dispatch(node, me->app, get_index(node), sm_class->event_indices[id]);
         return;
     }
-    walk_entry_down(node, NULL);
+#else
+    (void)id;
+#endif
+    node->info->fn(node, me->app);
 }
 
-static void walk_exit_down(vivid_node_t *node, const vivid_node_t *except)
+static bool call_handler(vivid_sm_t *me, vivid_node_t *node, const vivid_queue_entry_t *current_event VIVID_PARAM_ARGS(, const vivid_queue_entry_t *last_event))
 {
-    if (node != except) {
-        vivid_node_t *state = get_state(node);
-        if (state != NULL) {
-            walk_exit_down(state, NULL);
-            set_state(node, NULL);
+    me->current_event = current_event;
+#if VIVID_PARAM
+    me->last_event = last_event;
+#endif
+    call_state(me, node, current_event->id);
+    me->current_event = NULL;
+#if VIVID_PARAM
+    me->last_event = NULL;
+#endif
+    if (me->transition.path == NULL) {
+        return false;
+    }
+    entry_path(me->transition.path);
+    me->transition.path = NULL;
+    if ((me->state_change_callback != NULL) && me->transition.state_change) {
+        me->state_change_callback(me->app);
+    }
+    return true;
+}
+
+static void walk_event(vivid_sm_t *me, const vivid_queue_entry_t *current_event VIVID_PARAM_ARGS(, const vivid_queue_entry_t *last_event))
+{
+    const vivid_sm_class_t *sm_class = me->sm_class;
+    if (me->nodes_entered) {
+        me->nodes_entered = false;
+        for (size_t i = 0U; i < me->num_active_nodes; i++) {
+            me->nodes[me->active_nodes[i]].entered = false;
+        }
+    }
+    // Offer the event to the nodes that are active at this point, in document order. Subtrees that do
+    // not handle the event are skipped, as are the nodes entered by transitions during this walk:
+    size_t position = 0U;
+    while (position < me->num_active_nodes) {
+        vivid_node_index_t index = me->active_nodes[position];
+        vivid_node_t *node = &me->nodes[index];
+        if (node->entered || !is_in_event_set(sm_class, get_subtree_handlers(sm_class, index), current_event->id)) {
+            position = find_active_node(me, node->info->subtree_end);
+            continue;
+        }
+        if (is_in_event_set(sm_class, get_handlers(sm_class, index), current_event->id) && call_handler(me, node, current_event VIVID_PARAM_ARGS(, last_event))) {
+            // The active nodes have changed, so find the ones following this node again:
+            position = find_active_node(me, (vivid_node_index_t)(index + 1U));
+            continue;
+        }
+        position++;
+    }
+}
+
+static void sort_node_indices(vivid_node_index_t *indices, size_t num_indices)
+{
+    for (size_t i = 1U; i < num_indices; i++) {
+        vivid_node_index_t index = indices[i];
+        size_t j = i;
+        for (; (j > 0U) && (indices[j - 1U] > index); j--) {
+            indices[j] = indices[j - 1U];
         }
-        if (node->parallel_children) {
-            walk_exit_down(node->children, NULL);
+        indices[j] = index;
+    }
+}
+
+static void jump(vivid_sm_t *me VIVID_PARAM_ARGS(, const vivid_queue_entry_t *last_event))
+{
+    vivid_queue_entry_t entry = { 0 };
+    entry.name = m_jump_event.name;
+    entry.id = m_jump_event.id;
+    // Evaluate the jumps of the nodes entered since the last round, if still active, in document
+    // order. The nodes entered meanwhile are collected after them, for the next round:
+    while (me->num_jump_nodes > 0U) {
+        size_t num_nodes = me->num_jump_nodes;
+        sort_node_indices(me->jump_nodes, num_nodes);
+        for (size_t i = 0U; i < num_nodes; i++) {
+            vivid_node_t *node = &me->nodes[me->jump_nodes[i]];
+            if (node->jump_pending) {
+                node->jump_pending = false;
+                if (node->active) {
+                    (void)call_handler(me, node, &entry VIVID_PARAM_ARGS(, last_event));
+                }
+            }
+        }
+        me->num_jump_nodes -= num_nodes;
+        memmove(me->jump_nodes, &me->jump_nodes[num_nodes], me->num_jump_nodes * sizeof(*me->jump_nodes));
+    }
+}
+
+// Returns the queue of the highest priority lane holding events, if any:
+static vivid_queue_t *get_next_queue(vivid_sm_t *me)
+{
+    for (size_t lane = me->num_lanes; lane > 0U; lane--) {
+        if (!vivid_queue_empty(me->event_queues[lane - 1U])) {
+            return me->event_queues[lane - 1U];
         }
-        vivid_call_node(node, m_exit_string);
     }
-    if ((node->parent != NULL) && node->parent->parallel_children && (node->siblings != NULL)) {
-        walk_exit_down(node->siblings, except);
+    return NULL;
+}
+
+static void handle_event(vivid_sm_t *me, const vivid_queue_entry_t *event)
+{
+    me->event_handled = false;
+    walk_event(me, event VIVID_PARAM_ARGS(, NULL));
+    if (!me->event_handled) {
+        VIVID_LOG_DEBUG(me->log, "%s | event | %s (unhandled)", me->name, event->name);
+    }
+    jump(me VIVID_PARAM_ARGS(, event));
+}
+
+// Handles an event to completion, followed by the events dispatched meanwhile by the thread:
+static void dispatch(vivid_sm_t *me, const vivid_queue_entry_t *event)
+{
+    me->dispatching = true;
+    handle_event(me, event);
+    while ((me->local_queue != NULL) && !vivid_queue_empty(me->local_queue)) {
+        handle_event(me, vivid_queue_front(me->local_queue));
+        vivid_queue_pop(me->local_queue);
     }
+    me->dispatching = false;
+}
+
+static void start(vivid_sm_t *me)
+{
+    me->init = false;
+    me->dispatching = true;
+    walk_entry_down(&me->nodes[0], NULL);
+    jump(me VIVID_PARAM_ARGS(, NULL));
+    me->dispatching = false;
 }
 
-static void walk_exit_up(vivid_node_t *node, const vivid_node_t *ancestor, const vivid_node_t *branch, bool exit_ancestor)
+// Calls the watermark callback once the events queued reach the high watermark, and again once
+// they fall back to the low one:
+static void count_queued(vivid_sm_t *me, bool queued)
 {
-    vivid_node_t *state = get_state(node);
-    if ((branch == NULL) && (state != NULL)) {
-        walk_exit_down(state, NULL);
+#if VIVID_LOCKFREE
+    bool crossed;
+    if (queued) {
+        size_t num_queued = atomic_fetch_add(&me->num_queued, 1U) + 1U;
+        crossed = (num_queued >= me->high_watermark) && !atomic_exchange(&me->above_high_watermark, true);
+    } else {
+        size_t num_queued = atomic_fetch_sub(&me->num_queued, 1U) - 1U;
+        crossed = (num_queued <= me->low_watermark) && atomic_load(&me->above_high_watermark) && atomic_exchange(&me->above_high_watermark, false);
     }
-    if (node->parallel_children) {
-        walk_exit_down(node->children, branch);
+#else
+    (void)me->binding->lock_mutex(me->binding_mutex);
+    size_t num_queued = queued ? ++me->num_queued : --me->num_queued;
+    bool crossed = queued ? ((num_queued >= me->high_watermark) && !me->above_high_watermark) : ((num_queued <= me->low_watermark) && me->above_high_watermark);
+    if (crossed) {
+        me->above_high_watermark = queued;
+    }
+    me->binding->unlock_mutex(me->binding_mutex);
+#endif
+    if (crossed) {
+        me->watermark_callback(me->app, queued);
     }
-    set_state(node, NULL);
-    if ((node != ancestor) || exit_ancestor) {
-        vivid_call_node(node, m_exit_string);
+}
+
+// Counts an event dropped as its deadline has passed, by event id:
+static void drop_expired_event(vivid_sm_t *me, const vivid_queue_entry_t *event)
+{
+    VIVID_LOG_DEBUG(me->log, "%s | event | %s (expired)", me->name, event->name);
+    me->num_expired_total++;
+    size_t num_ids = 32U * me->sm_class->num_event_words;
+    if (me->num_expired_events == NULL) {
+        me->num_expired_events = (size_t *)me->binding->calloc(me->binding, num_ids, sizeof(*me->num_expired_events));
     }
-    if ((node->parent != NULL) && (node != ancestor)) {
-        walk_exit_up(node->parent, ancestor, node, exit_ancestor);
+    if ((me->num_expired_events != NULL) && (event->id < num_ids)) {
+        me->num_expired_events[event->id]++;
     }
 }
 
-static void walk_event(vivid_node_t *node, const vivid_queue_entry_t *current_event VIVID_PARAM_ARGS(, const vivid_queue_entry_t *last_event))
+static void event_callback(void *data)
 {
-    vivid_sm_t *me = node->vsm;
-    node->current_event = current_event;
-#if VIVID_PARAM
-    node->last_event = last_event;
+    vivid_sm_t *me = (vivid_sm_t *)data;
+    if (me->init) {
+        start(me);
+    }
+    // Handle a batch of events per wakeup, each one to completion, and only wake up again if the
+    // budget runs out before the queue does:
+    vivid_time_t end_time = 0;
+    if (me->event_budget_time > 0) {
+        end_time = me->binding->get_time(me->binding) + me->event_budget_time;
+    }
+    size_t num_events = 0U;
+    for (;;) {
+        vivid_queue_t *queue = get_next_queue(me);
+        if (queue == NULL) {
+            break;
+        }
+        if (((me->event_budget_count > 0U) && (num_events == me->event_budget_count))
+                || ((me->event_budget_time > 0) && (num_events > 0U) && (me->binding->get_time(me->binding) >= end_time))) {
+            me->binding->trigger_event(me->binding_event);
+            return;
+        }
+        const vivid_queue_entry_t *event = vivid_queue_front(queue);
+        // Queue the event again if raised from now on, as the state machine may already have moved on:
+        if (is_in_event_set(me->sm_class, me->sm_class->coalesced_events, event->id)) {
+            clear_pending(me, event->id);
+        }
+        // Drop a stale event without walking the states, nor counting it against the budget:
+        bool expired = (event->deadline > 0) && (me->binding->get_time(me->binding) >= event->deadline);
+        if (expired) {
+            drop_expired_event(me, event);
+        } else {
+            dispatch(me, event);
+        }
+        vivid_queue_pop(queue);
+        if (me->watermark_callback != NULL) {
+            count_queued(me, false);
+        }
+        if (!expired) {
+            num_events++;
+        }
+    }
+}
+
+static void set_slot_timer(vivid_timer_slot_t *slot, vivid_sm_timer_t *timer)
+{
+#if VIVID_LOCKFREE
+    atomic_store(&slot->timer, timer);
+#else
+    vivid_sm_t *me = slot->vsm;
+    (void)me->binding->lock_mutex(me->binding_mutex);
+    slot->timer = timer;
+    me->binding->unlock_mutex(me->binding_mutex);
 #endif
-    node->fn(node, me->app);
-    node->current_event = NULL;
-#if VIVID_PARAM
-    node->last_event = NULL;
+}
+
+static vivid_sm_timer_t *get_slot_timer(vivid_timer_slot_t *slot)
+{
+#if VIVID_LOCKFREE
+    return atomic_load(&slot->timer);
+#else
+    vivid_sm_t *me = slot->vsm;
+    (void)me->binding->lock_mutex(me->binding_mutex);
+    vivid_sm_timer_t *timer = slot->timer;
+    me->binding->unlock_mutex(me->binding_mutex);
+    return timer;
 #endif
-    if (me->transition.target != NULL) {
-        walk_entry_up(me->transition.target, me->transition.ancestor, NULL, me->transition.reenter_ancestor);
-        me->transition.target = NULL;
-        if ((me->state_change_callback != NULL) && me->transition.state_change) {
-            me->state_change_callback(me->app);
+}
+
+static void timer_callback(void *data)
+{
+    vivid_timer_slot_t *slot = (vivid_timer_slot_t *)data;
+    // An expiry racing with the stop of the timer may find the slot spare, or held by another timer,
+    // which ignores it as it is not due yet:
+    vivid_sm_timer_t *timer = get_slot_timer(slot);
+    if (timer != NULL) {
+        vivid_queue_event(slot->vsm, timer->info->event VIVID_PARAM_ARGS(, NULL, VIVID_PARAM_STATIC_ARGS(0U) VIVID_PARAM_DYNAMIC_ARGS(NULL)));
+    }
+}
+
+// Gives a binding timer to a timer whose state is entered, taken from the spares of the instance
+// or created, so that the instances only hold as many binding timers as the most timers active at
+// the same time so far:
+static bool acquire_timer(vivid_sm_t *me, vivid_sm_timer_t *timer)
+{
+    vivid_timer_slot_t *slot = me->spare_timers;
+    if (slot != NULL) {
+        me->spare_timers = slot->next_spare;
+    } else {
+        slot = (vivid_timer_slot_t *)me->binding->calloc(me->binding, 1U, sizeof(*slot));
+        if (slot == NULL) {
+            goto error;
+        }
+        slot->vsm = me;
+        slot->binding_timer = me->binding->create_timer(me->binding, timer_callback, slot);
+        if (slot->binding_timer == NULL) {
+            me->binding->free(slot);
+            goto error;
         }
+    }
+    set_slot_timer(slot, timer);
+    timer->slot = slot;
+    return true;
+error:
+    VIVID_LOG_ERROR(me->log, "%s | could not create timer %s", me->name, timer->info->event->name);
+    if (me->binding->error_hook != NULL) {
+        me->binding->error_hook(me->binding->app, VIVID_ERROR_TIMER);
+    }
+    return false;
+}
+
+// Keeps the binding timer of a stopped timer as a spare, rather than destroying it while its
+// callback may still be running:
+static void release_timer(vivid_sm_t *me, vivid_sm_timer_t *timer)
+{
+    vivid_timer_slot_t *slot = timer->slot;
+    set_slot_timer(slot, NULL);
+    slot->next_spare = me->spare_timers;
+    me->spare_timers = slot;
+    timer->slot = NULL;
+}
+
+static void destroy_timer_slot(vivid_sm_t *me, vivid_timer_slot_t *slot)
+{
+    me->binding->destroy_timer(slot->binding_timer);
+    me->binding->free(slot);
+}
+
+// Frees the instance used to walk the state functions of a class:
+static void destroy_init_sm(vivid_sm_t *me)
+{
+    if (me == NULL) {
         return;
     }
-    if (node->parallel_children) {
-        walk_event(node->children, current_event VIVID_PARAM_ARGS(, last_event));
+    me->binding->free(me->arena);
+    me->binding->free(me);
+}
+
+// Creates a class, along with the instance calling its state functions to record its topology:
+static vivid_sm_class_t *create_class(vivid_binding_t *binding, void *app VIVID_LOG_ARGS(, const char *name), vivid_sm_t **init_sm)
+{
+    vivid_sm_class_t *me = (vivid_sm_class_t *)binding->calloc(binding, 1U, sizeof(*me));
+    if (me == NULL) {
+        return NULL;
+    }
+    me->binding = binding;
+    vivid_sm_t *vsm = (vivid_sm_t *)binding->calloc(binding, 1U, sizeof(*vsm));
+    if (vsm == NULL) {
+        goto error;
+    }
+    vsm->binding = binding;
+    vsm->sm_class = me;
+    vsm->app = app;
+#if VIVID_LOG
+    me->name = name;
+    me->log = vivid_log_create(binding, VIVID_LOG_BUFFER_SIZE);
+    if (me->log == NULL) {
+        goto error;
+    }
+    vsm->name = name;
+    vsm->log = me->log;
+#endif
+#if VIVID_UML
+    me->uml = vivid_uml_create(binding, me->log);
+    if (me->uml == NULL) {
+        goto error;
+    }
+#endif
+    *init_sm = vsm;
+    return me;
+
+error:
+    destroy_init_sm(vsm);
+    vivid_destroy_sm_class(me);
+    return NULL;
+}
+
+vivid_sm_class_t *vivid_create_sm_class(vivid_binding_t *binding, vivid_state_t root_fn, void *app VIVID_LOG_ARGS(, const char *name, const char *root_name))
+{
+    vivid_sm_t *vsm = NULL;
+    vivid_sm_class_t *me = create_class(binding, app VIVID_LOG_ARGS(, name), &vsm);
+    if (me == NULL) {
+        return NULL;
+    }
+
+    // Count the nodes and timers first, so that they can be placed in a single allocation:
+    vsm->init_sizing = true;
+    if (!walk_size(vsm, root_fn, NULL VIVID_LOG_ARGS(, root_name))) {
+        goto error;
+    }
+    vsm->init_sizing = false;
+    if (!create_class_arena(me, true) || !create_arena(vsm, 0U) || (walk_init(vsm, root_fn, 0U VIVID_LOG_ARGS(, root_name)) == NULL)) {
+        goto error;
+    }
+    destroy_init_sm(vsm);
+    return me;
+
+error:
+    destroy_init_sm(vsm);
+    vivid_destroy_sm_class(me);
+    return NULL;
+}
+
+// Calls the state functions with timeouts, the other ones having nothing to record:
+static bool record_timers(vivid_sm_t *me, const vivid_sm_tables_t *tables)
+{
+    for (size_t i = 0U; i < tables->num_nodes; i++) {
+        if (tables->handlers[i].timers) {
+            vivid_call_node(&me->nodes[i], &m_init_event);
+            if (me->init_error) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+vivid_sm_class_t *vivid_create_sm_class_from_tables(vivid_binding_t *binding, const vivid_sm_tables_t *tables, void *app VIVID_LOG_ARGS(, const char *name))
+{
+    vivid_sm_t *vsm = NULL;
+    vivid_sm_class_t *me = create_class(binding, app VIVID_LOG_ARGS(, name), &vsm);
+    if (me == NULL) {
+        return NULL;
+    }
+    me->nodes = tables->nodes;
+    me->num_nodes = tables->num_nodes;
+#if VIVID_DISPATCH
+    me->dispatch = tables->dispatch;
+#endif
+#if VIVID_PARAM_STATIC
+    me->max_param_size = tables->max_param_size;
+#endif
+    for (size_t i = 0U; i < me->num_nodes; i++) {
+        if (me->nodes[i].depth > me->max_depth) {
+            me->max_depth = me->nodes[i].depth;
+        }
+    }
+    for (vivid_event_t *const *event = tables->events; *event != NULL; event++) {
+        if (!register_event(vsm, *event)) {
+            goto error;
+        }
+    }
+
+    // Count the timers first, as for the nodes in vivid_create_sm_class():
+    vsm->init_timers = true;
+    vsm->init_sizing = true;
+    if (!create_arena(vsm, 0U) || !record_timers(vsm, tables)) {
+        goto error;
+    }
+    vsm->init_sizing = false;
+    if (!create_class_arena(me, false) || !record_timers(vsm, tables)) {
+        goto error;
+    }
+    for (vivid_node_index_t i = 0U; i < me->num_nodes; i++) {
+        vivid_node_index_t *entry = find_node_table_entry(me, me->nodes[i].fn);
+        if (*entry != VIVID_NODE_INDEX_NONE) {
+            VIVID_LOG_ERROR(vsm->log, "sub-state defined more than once: %s", me->nodes[i].name);
+            goto error;
+        }
+        *entry = i;
+        const vivid_node_handlers_t *handlers = &tables->handlers[i];
+        for (vivid_event_t *const *event = handlers->events; *event != NULL; event++) {
+            add_to_event_set(get_handlers(me, i), (*event)->id);
+            if ((*event)->coalesce) {
+                add_to_event_set(me->coalesced_events, (*event)->id);
+            }
+        }
+        if (handlers->jumps) {
+            add_to_event_set(get_handlers(me, i), VIVID_EVENT_ID_JUMP);
+        }
+    }
+    // The children follow their parent, so their subtree handlers are complete first:
+    for (size_t i = me->num_nodes; i > 0U; i--) {
+        collect_subtree_handlers(me, (vivid_node_index_t)(i - 1U));
+    }
+#if VIVID_DISPATCH
+    for (size_t i = 0U; (me->dispatch != NULL) && (tables->events[i] != NULL); i++) {
+        me->event_indices[tables->events[i]->id] = (uint16_t)i;
+    }
+#endif
+    destroy_init_sm(vsm);
+    return me;
+
+error:
+    destroy_init_sm(vsm);
+    vivid_destroy_sm_class(me);
+    return NULL;
+}
+
+void vivid_destroy_sm_class(vivid_sm_class_t *me)
+{
+    if (me == NULL) {
+        return;
     }
-    if ((node->parent != NULL) && node->parent->parallel_children && (node->siblings != NULL)) {
-        walk_event(node->siblings, current_event VIVID_PARAM_ARGS(, last_event));
+    me->binding->free(me->arena);
+    vivid_uml_destroy(me->uml);
+    vivid_log_destroy(me->log);
+    me->binding->free(me);
+}
+
+vivid_sm_t *vivid_create_sm(vivid_binding_t *binding, vivid_state_t root_fn, size_t event_queue_size, void *app VIVID_LOG_ARGS(, const char *name, const char *root_name))
+{
+    return vivid_create_sm_with_lanes(binding, root_fn, event_queue_size, 1U, app VIVID_LOG_ARGS(, name, root_name));
+}
+
+// Creates an instance owning its class, which is destroyed along with it:
+static vivid_sm_t *create_sm_owning_class(vivid_binding_t *binding, vivid_sm_class_t *sm_class, size_t event_queue_size, size_t num_lanes, void *app VIVID_LOG_ARGS(, const char *name))
+{
+    if (sm_class == NULL) {
+        return NULL;
     }
-    vivid_node_t *state = get_state(node);
-    if (state != NULL) {
-        walk_event(state, current_event VIVID_PARAM_ARGS(, last_event));
+    vivid_sm_t *me = vivid_create_sm_from_class(binding, sm_class, event_queue_size, num_lanes, app VIVID_LOG_ARGS(, name));
+    if (me == NULL) {
+        vivid_destroy_sm_class(sm_class);
+        return NULL;
     }
+    me->owns_class = true;
+    return me;
 }
 
-static void jump(vivid_sm_t *me VIVID_PARAM_ARGS(, const vivid_queue_entry_t *last_event))
+vivid_sm_t *vivid_create_sm_with_lanes(vivid_binding_t *binding, vivid_state_t root_fn, size_t event_queue_size, size_t num_lanes, void *app VIVID_LOG_ARGS(, const char *name, const char *root_name))
 {
-    vivid_queue_entry_t event = { 0 };
-    event.name = m_jump_string;
-    while (me->jump) {
-        me->jump = false;
-        walk_event(me->root_node, &event VIVID_PARAM_ARGS(, last_event));
-    }
+    vivid_sm_class_t *sm_class = vivid_create_sm_class(binding, root_fn, app VIVID_LOG_ARGS(, name, root_name));
+    return create_sm_owning_class(binding, sm_class, event_queue_size, num_lanes, app VIVID_LOG_ARGS(, name));
 }
 
-static void event_callback(void *data)
+vivid_sm_t *vivid_create_sm_from_tables(vivid_binding_t *binding, const vivid_sm_tables_t *tables, size_t event_queue_size, void *app VIVID_LOG_ARGS(, const char *name))
 {
-    vivid_sm_t *me = (vivid_sm_t *)data;
-    if (me->init) {
-        me->init = false;
-        walk_entry_down(me->root_node, NULL);
-        jump(me VIVID_PARAM_ARGS(, NULL));
-    }
-    if (vivid_queue_empty(me->event_queue)) {
-        return;
-    }
-    const vivid_queue_entry_t *event = vivid_queue_front(me->event_queue);
-    me->event_handled = false;
-    walk_event(me->root_node, event, NULL);
-    if (!me->event_handled) {
-        VIVID_LOG_DEBUG(me->log, "%s | event | %s (unhandled)", me->name, event->name);
-    }
-    jump(me VIVID_PARAM_ARGS(, event));
-    vivid_queue_pop(me->event_queue);
-    if (!vivid_queue_empty(me->event_queue)) {
-        me->binding->trigger_event(me->binding_event);
-    }
+    vivid_sm_class_t *sm_class = vivid_create_sm_class_from_tables(binding, tables, app VIVID_LOG_ARGS(, name));
+    return create_sm_owning_class(binding, sm_class, event_queue_size, 1U, app VIVID_LOG_ARGS(, name));
 }
 
-vivid_sm_t *vivid_create_sm(vivid_binding_t *binding, vivid_state_t root_fn, size_t event_queue_size, void *app VIVID_LOG_ARGS(, const char *name, const char *root_name))
+vivid_sm_t *vivid_create_sm_from_class(vivid_binding_t *binding, vivid_sm_class_t *sm_class, size_t event_queue_size, size_t num_lanes, void *app VIVID_LOG_ARGS(, const char *name))
 {
     vivid_sm_t *me = (vivid_sm_t *)binding->calloc(binding, 1U, sizeof(*me));
     if (me == NULL) {
         return NULL;
     }
     me->binding = binding;
+    me->sm_class = sm_class;
     me->app = app;
+    me->event_budget_count = VIVID_EVENT_BUDGET;
     me->binding_event = binding->create_event(binding, event_callback, me);
-    me->node_map = vivid_map_create(binding);
-    me->timer_map = vivid_map_create(binding);
-    if ((me->binding_event == NULL) || (me->node_map == NULL) || (me->timer_map == NULL)) {
+    if (me->binding_event == NULL) {
         goto error;
     }
 #if VIVID_LOG
     me->name = name;
-    me->log = vivid_log_create(binding, VIVID_LOG_BUFFER_SIZE);
-    if (me->log == NULL) {
-        goto error;
-    }
-#endif
-#if VIVID_UML
-    me->uml = vivid_uml_create(binding, me->log);
-    if (me->uml == NULL) {
-        goto error;
+    // The log buffer is shared by the instances created on the binding of the class, i.e. on its thread:
+    me->log = sm_class->log;
+    if (binding != sm_class->binding) {
+        me->log = vivid_log_create(binding, VIVID_LOG_BUFFER_SIZE);
+        if (me->log == NULL) {
+            goto error;
+        }
     }
 #endif
 #if !VIVID_LOCKFREE
@@ -273,16 +1140,23 @@ vivid_sm_t *vivid_create_sm(vivid_binding_t *binding, vivid_state_t root_fn, siz
     }
 #endif
 
-    me->root_node = walk_init(me, root_fn, 0U VIVID_LOG_ARGS(, root_name));
-    if (me->root_node == NULL) {
+    if ((num_lanes == 0U) || (num_lanes > (UINT8_MAX + 1U))) {
+        VIVID_LOG_ERROR(me->log, "%s | invalid number of lanes", me->name);
         goto error;
     }
-
-    me->event_queue = vivid_queue_create(binding, event_queue_size VIVID_PARAM_STATIC_ARGS(, me->max_param_size));
-    if ((me->event_queue == NULL)) {
+    // The binding timers are only created once their states are entered, see acquire_timer():
+    if (!create_arena(me, num_lanes)) {
         goto error;
     }
 
+    for (size_t i = 0U; i < num_lanes; i++) {
+        me->event_queues[i] = vivid_queue_create(binding, event_queue_size VIVID_PARAM_STATIC_ARGS(, sm_class->max_param_size));
+        if (me->event_queues[i] == NULL) {
+            goto error;
+        }
+    }
+    me->local_queue_size = event_queue_size;
+
     me->init = true;
     binding->trigger_event(me->binding_event);
     return me;
@@ -292,39 +1166,48 @@ error:
     return NULL;
 }
 
-static void destroy_timer(void *app, size_t key, void *value)
-{
-    (void)key;
-    vivid_sm_t *me = (vivid_sm_t *)app;
-    vivid_sm_timer_t *timer = (vivid_sm_timer_t *)value;
-    me->binding->destroy_timer(timer->binding_timer);
-    me->binding->free(timer);
-}
-
-static void destroy_node(void *app, size_t key, void *value)
-{
-    (void)key;
-    vivid_sm_t *me = (vivid_sm_t *)app;
-    vivid_node_t *node = (vivid_node_t *)value;
-    me->binding->free(node);
-}
-
 void vivid_destroy_sm(vivid_sm_t *me)
 {
     if (me == NULL) {
         return;
     }
-    vivid_queue_destroy(me->event_queue);
-    vivid_map_iterate(me->timer_map, destroy_timer, me);
-    vivid_map_destroy(me->timer_map);
-    vivid_map_iterate(me->node_map, destroy_node, me);
-    vivid_map_destroy(me->node_map);
+    for (size_t i = 0U; i < me->num_lanes; i++) {
+        vivid_queue_destroy(me->event_queues[i]);
+    }
+    vivid_queue_destroy(me->local_queue);
+    vivid_queue_destroy_pool(me->queue_pool);
+    me->binding->free(me->num_expired_events);
+    for (size_t i = 0U; (me->arena != NULL) && (i < me->sm_class->num_timers); i++) {
+        if (me->timers[i].slot != NULL) {
+            destroy_timer_slot(me, me->timers[i].slot);
+        }
+    }
+    while (me->spare_timers != NULL) {
+        vivid_timer_slot_t *next = me->spare_timers->next_spare;
+        destroy_timer_slot(me, me->spare_timers);
+        me->spare_timers = next;
+    }
+    for (size_t i = 0U; (me->arena != NULL) && (i < me->sm_class->num_nodes); i++) {
+        vivid_node_t *node = &me->nodes[i];
+        while (node->transitions != NULL) {
+            vivid_transition_path_t *next = node->transitions->next;
+            me->binding->free(node->transitions);
+            node->transitions = next;
+        }
+    }
+    me->binding->free(me->arena);
 #if !VIVID_LOCKFREE
     me->binding->destroy_mutex(me->binding_mutex);
 #endif
-    vivid_uml_destroy(me->uml);
-    vivid_log_destroy(me->log);
+#if VIVID_LOG
+    if (me->log != me->sm_class->log) {
+        vivid_log_destroy(me->log);
+    }
+#endif
     me->binding->destroy_event(me->binding_event);
+    if (me->owns_class) {
+        vivid_destroy_sm_class(me->sm_class);
+    }
     me->binding->free(me);
 }
 
@@ -333,11 +1216,147 @@ vivid_binding_t *vivid_get_binding(vivid_sm_t *me)
     return me->binding;
 }
 
+size_t vivid_get_num_node_lookups(vivid_sm_t *me)
+{
+    return me->num_node_lookups;
+}
+
 void vivid_set_state_change_callback(vivid_sm_t *me, vivid_state_change_callback_t callback)
 {
     me->state_change_callback = callback;
 }
 
+#if VIVID_LOG
+void vivid_set_log_level(vivid_sm_t *me, vivid_log_level_t level)
+{
+    // Give the instance its own log, so that the level of the other instances of its class is kept:
+    if ((me->log == me->sm_class->log) && !me->owns_class) {
+        vivid_log_t *log = vivid_log_create(me->binding, VIVID_LOG_BUFFER_SIZE);
+        if (log == NULL) {
+            vivid_log_error(me->binding, "could not create log");
+            return;
+        }
+        me->log = log;
+    }
+    vivid_log_set_level(me->log, level);
+}
+#endif
+
+void vivid_set_event_budget(vivid_sm_t *me, size_t max_events, vivid_time_t max_time)
+{
+    me->event_budget_count = max_events;
+    me->event_budget_time = max_time;
+}
+
+// Creates a queue growing with the pool of the state machine, if any:
+static vivid_queue_t *create_queue(vivid_sm_t *me, vivid_queue_producers_t producers)
+{
+    vivid_queue_t *queue = vivid_queue_create_with_producers(me->binding, me->local_queue_size, producers VIVID_PARAM_STATIC_ARGS(, me->sm_class->max_param_size));
+    if ((queue != NULL) && !vivid_queue_set_pool(queue, me->queue_pool)) {
+        vivid_queue_destroy(queue);
+        return NULL;
+    }
+    return queue;
+}
+
+bool vivid_set_single_producer(vivid_sm_t *me, size_t lane)
+{
+    if ((lane >= me->num_lanes) || !vivid_queue_empty(me->event_queues[lane])) {
+        VIVID_LOG_ERROR(me->log, "%s | could not set single producer of lane %u", me->name, (unsigned)lane);
+        return false;
+    }
+    vivid_queue_t *queue = create_queue(me, VIVID_QUEUE_SINGLE_PRODUCER);
+    if (queue == NULL) {
+        return false;
+    }
+    vivid_queue_destroy(me->event_queues[lane]);
+    me->event_queues[lane] = queue;
+    return true;
+}
+
+bool vivid_set_queue_pool(vivid_sm_t *me, vivid_queue_pool_t *pool, size_t max_bytes)
+{
+    if (me->queue_pool != NULL) {
+        VIVID_LOG_ERROR(me->log, "%s | queue pool already set", me->name);
+        return false;
+    }
+    me->queue_pool = vivid_queue_create_sub_pool(pool, max_bytes);
+    if (me->queue_pool == NULL) {
+        return false;
+    }
+    for (size_t i = 0U; i < me->num_lanes; i++) {
+        if (!vivid_queue_set_pool(me->event_queues[i], me->queue_pool)) {
+            goto error;
+        }
+    }
+    if ((me->local_queue != NULL) && !vivid_queue_set_pool(me->local_queue, me->queue_pool)) {
+        goto error;
+    }
+    return true;
+error:
+    VIVID_LOG_ERROR(me->log, "%s | queue pool too small for the params of the events", me->name);
+    // Leave the queues without pool, so that another one may be set:
+    for (size_t i = 0U; i < me->num_lanes; i++) {
+        (void)vivid_queue_set_pool(me->event_queues[i], NULL);
+    }
+    if (me->local_queue != NULL) {
+        (void)vivid_queue_set_pool(me->local_queue, NULL);
+    }
+    vivid_queue_destroy_pool(me->queue_pool);
+    me->queue_pool = NULL;
+    return false;
+}
+
+#if VIVID_PARAM_STATIC
+size_t vivid_get_max_param_size(vivid_sm_t *me)
+{
+    return me->sm_class->max_param_size;
+}
+#endif
+
+bool vivid_set_overload_policy(vivid_sm_t *me, vivid_overload_policy_t policy, vivid_time_t block_timeout)
+{
+#if VIVID_LOCKFREE
+    if ((policy == VIVID_OVERLOAD_DROP_OLDEST) || (policy == VIVID_OVERLOAD_REPLACE_SAME)) {
+        VIVID_LOG_ERROR(me->log, "%s | overload policy not available with VIVID_LOCKFREE", me->name);
+        return false;
+    }
+#endif
+    me->overload_policy = policy;
+    me->block_timeout = block_timeout;
+    return true;
+}
+
+void vivid_set_watermarks(vivid_sm_t *me, size_t high, size_t low, vivid_watermark_callback_t callback)
+{
+    me->high_watermark = high;
+    me->low_watermark = low;
+    me->watermark_callback = callback;
+}
+
+size_t vivid_get_num_dropped_events(vivid_sm_t *me)
+{
+#if VIVID_LOCKFREE
+    return atomic_load(&me->num_dropped_events);
+#else
+    (void)me->binding->lock_mutex(me->binding_mutex);
+    size_t num_dropped_events = me->num_dropped_events;
+    me->binding->unlock_mutex(me->binding_mutex);
+    return num_dropped_events;
+#endif
+}
+
+size_t vivid_get_num_expired_events(vivid_sm_t *me, const vivid_event_t *event)
+{
+    if (event == NULL) {
+        return me->num_expired_total;
+    }
+    if ((me->num_expired_events == NULL) || (event->id >= (32U * me->sm_class->num_event_words))) {
+        return 0U;
+    }
+    return me->num_expired_events[event->id];
+}
+
 #if VIVID_LOG
 static const char *get_node_type_string(vivid_node_type_t type)
 {
@@ -357,157 +1376,179 @@ static const char *get_node_type_string(vivid_node_type_t type)
 
 void vivid_sub_node(vivid_node_t *node, vivid_state_t fn, vivid_node_type_t type VIVID_LOG_ARGS(, const char *name VIVID_UML_ARGS(, const char *json_props)))
 {
-    if (node->current_event->name != m_init_string) {
+    vivid_sm_t *me = node->vsm;
+    if ((me->current_event->id != VIVID_EVENT_ID_INIT) || me->init_timers) {
         return;
     }
-    vivid_sm_t *me = node->vsm;
-    VIVID_LOG_DEBUG(me->log, "%s | init | %s | sub-%s: %s", me->name, node->name, get_node_type_string(type), name);
+    if (me->init_sizing) {
+        if (!walk_size(me, fn, (const vivid_size_node_t *)node VIVID_LOG_ARGS(, name))) {
+            me->init_error = true;
+        }
+        return;
+    }
+    vivid_node_info_t *info = get_init_info(node);
+    VIVID_LOG_DEBUG(me->log, "%s | init | %s | sub-%s: %s", me->name, info->name, get_node_type_string(type), name);
     if ((type == VIVID_NODE_TYPE_STATE_PARALLEL)
-            ? ((node->children != NULL) && !node->parallel_children)
-            : node->parallel_children) {
-        VIVID_LOG_ERROR(me->log, "%s | init | %s | parallel and non-parallel sub-states", me->name, node->name);
+            ? ((info->children != VIVID_NODE_INDEX_NONE) && !info->parallel_children)
+            : info->parallel_children) {
+        VIVID_LOG_ERROR(me->log, "%s | init | %s | parallel and non-parallel sub-states", me->name, info->name);
         me->init_error = true;
         return;
     }
-    vivid_node_t *sub_node = walk_init(me, fn, node->depth + 1U VIVID_LOG_ARGS(, name));
+    vivid_node_t *sub_node = walk_init(me, fn, (vivid_node_index_t)(info->depth + 1U) VIVID_LOG_ARGS(, name));
     if (sub_node == NULL) {
         me->init_error = true;
         return;
     }
-    sub_node->type = type;
-    sub_node->parent = node;
-    sub_node->siblings = node->children;
+    vivid_node_info_t *sub_info = get_init_info(sub_node);
+    sub_info->type = type;
+    sub_info->parent = get_index(node);
+    sub_info->siblings = info->children;
 #if VIVID_UML
-    sub_node->json_props = json_props;
+    sub_info->json_props = json_props;
 #endif
-    node->children = sub_node;
-    node->parallel_children = type == VIVID_NODE_TYPE_STATE_PARALLEL;
+    info->children = get_index(sub_node);
+    info->parallel_children = type == VIVID_NODE_TYPE_STATE_PARALLEL;
 }
 
 bool vivid_default(vivid_node_t *node, vivid_state_t fn VIVID_LOG_ARGS(, const char *name VIVID_UML_ARGS(, const char *action_text, const char *json_props)))
 {
     vivid_uml_on_transition(node, VIVID_TRANSITION_TYPE_DEFAULT, "", "", m_true_string, name, fn, action_text, json_props);
     vivid_sm_t *me = node->vsm;
-    if (node->current_event->name == m_init_string) {
-        if (node->default_child != NULL) {
-            VIVID_LOG_ERROR(me->log, "%s | init | %s | default already defined as %s", me->name, node->name, node->default_child->name);
+    if (me->current_event->id == VIVID_EVENT_ID_INIT) {
+        if (me->init_sizing || me->init_timers) {
+            return false;
+        }
+        vivid_node_info_t *info = get_init_info(node);
+        if (info->default_child != VIVID_NODE_INDEX_NONE) {
+            VIVID_LOG_ERROR(me->log, "%s | init | %s | default already defined as %s", me->name, info->name, me->sm_class->nodes[info->default_child].name);
             me->init_error = true;
             return false;
         }
-        vivid_node_t *sub_node = (vivid_node_t *)vivid_map_get(me->node_map, (size_t)fn);
+        vivid_node_t *sub_node = vivid_find_node(me, fn);
         if (sub_node == NULL) {
-            VIVID_LOG_ERROR(me->log, "%s | init | %s | sub-state %s not yet defined", me->name, node->name, name);
+            VIVID_LOG_ERROR(me->log, "%s | init | %s | sub-state %s not yet defined", me->name, info->name, name);
             me->init_error = true;
             return false;
         }
-        VIVID_LOG_DEBUG(me->log, "%s | init | %s | default: %s", me->name, node->name, name);
-        node->default_child = sub_node;
+        VIVID_LOG_DEBUG(me->log, "%s | init | %s | default: %s", me->name, info->name, name);
+        info->default_child = get_index(sub_node);
         return false;
     }
-    if (node->current_event->name != m_entry_string) {
+    if (me->current_event->id != VIVID_EVENT_ID_ENTRY) {
         return false;
     }
-    VIVID_LOG_DEBUG(me->log, "%s | default | %s | %s", me->name, node->name, name);
+    VIVID_LOG_DEBUG(me->log, "%s | default | %s | %s", me->name, node->info->name, name);
     return true;
 }
 
 bool vivid_on_entry(vivid_node_t *node VIVID_UML_ARGS(, const char *action_text))
 {
-    vivid_uml_on_entry_or_exit(node, m_entry_string, action_text);
-    if (node->current_event->name != m_entry_string) {
+    vivid_uml_on_entry_or_exit(node, m_entry_event.name, action_text);
+    if (node->vsm->current_event->id != VIVID_EVENT_ID_ENTRY) {
         return false;
     }
-    VIVID_LOG_DEBUG(node->vsm->log, "%s | entry | %s", node->vsm->name, node->name);
+    VIVID_LOG_DEBUG(node->vsm->log, "%s | entry | %s", node->vsm->name, node->info->name);
     return true;
 }
 
 bool vivid_on_exit(vivid_node_t *node VIVID_UML_ARGS(, const char *action_text))
 {
-    vivid_uml_on_entry_or_exit(node, m_exit_string, action_text);
-    if (node->current_event->name != m_exit_string) {
+    vivid_uml_on_entry_or_exit(node, m_exit_event.name, action_text);
+    if (node->vsm->current_event->id != VIVID_EVENT_ID_EXIT) {
         return false;
     }
-    VIVID_LOG_DEBUG(node->vsm->log, "%s | exit | %s", node->vsm->name, node->name);
+    VIVID_LOG_DEBUG(node->vsm->log, "%s | exit | %s", node->vsm->name, node->info->name);
     return true;
 }
 
-bool vivid_on_event(vivid_node_t *node, const char *name VIVID_PARAM_ARGS(, const void **param VIVID_PARAM_STATIC_ARGS(, size_t param_size)) VIVID_UML_ARGS(, vivid_state_t target_fn, const char *guard_text, const char *target_name, const char *action_text, const char *json_props))
+bool vivid_on_event(vivid_node_t *node, vivid_event_t *event VIVID_PARAM_ARGS(, const void **param VIVID_PARAM_STATIC_ARGS(, size_t param_size)) VIVID_UML_ARGS(, vivid_state_t target_fn, const char *guard_text, const char *target_name, const char *action_text, const char *json_props))
 {
-    vivid_uml_on_transition(node, VIVID_TRANSITION_TYPE_EVENT, name, "", guard_text, target_name, target_fn, action_text, json_props);
+    vivid_uml_on_transition(node, VIVID_TRANSITION_TYPE_EVENT, event->name, "", guard_text, target_name, target_fn, action_text, json_props);
     vivid_sm_t *me = node->vsm;
+    if (me->current_event->id == VIVID_EVENT_ID_INIT) {
 #if VIVID_PARAM_STATIC
-    if (node->current_event->name == m_init_string) {
-        if (param_size > me->max_param_size) {
-            me->max_param_size = param_size;
+        if (param_size > me->sm_class->max_param_size) {
+            me->sm_class->max_param_size = param_size;
+        }
+#endif
+        if (!register_event(me, event)) {
+            me->init_error = true;
+        } else if (!me->init_sizing) {
+            add_handler(node, event->id);
+            if (event->coalesce) {
+                add_to_event_set(me->sm_class->coalesced_events, event->id);
+            }
         }
         return false;
     }
-#endif
-    if (node->current_event->name != name) {
+    if (me->current_event->id != event->id) {
         return false;
     }
 #if VIVID_PARAM
     if (param != NULL) {
-        *param = node->current_event->param;
+        *param = me->current_event->param;
     }
 #endif
     me->event_handled = true;
     return true;
 }
 
-static void timer_callback(void *data)
-{
-    vivid_sm_timer_t *timer = (vivid_sm_timer_t *)data;
-    vivid_queue_event(timer->vsm, timer->name VIVID_PARAM_ARGS(, NULL, VIVID_PARAM_STATIC_ARGS(0U) VIVID_PARAM_DYNAMIC_ARGS(NULL)));
-}
-
-bool vivid_on_timeout(vivid_node_t *node, const char *name, vivid_time_t timeout VIVID_UML_ARGS(, vivid_state_t target_fn, const char *timeout_text, const char *guard_text, const char *target_name, const char *action_text, const char *json_props))
+bool vivid_on_timeout(vivid_node_t *node, vivid_event_t *event, vivid_time_t timeout VIVID_UML_ARGS(, vivid_state_t target_fn, const char *timeout_text, const char *guard_text, const char *target_name, const char *action_text, const char *json_props))
 {
-    vivid_uml_on_transition(node, VIVID_TRANSITION_TYPE_TIMEOUT, name, timeout_text, guard_text, target_name, target_fn, action_text, json_props);
+    vivid_uml_on_transition(node, VIVID_TRANSITION_TYPE_TIMEOUT, event->name, timeout_text, guard_text, target_name, target_fn, action_text, json_props);
     vivid_sm_t *me = node->vsm;
-    if (node->current_event->name == m_init_string) {
-        vivid_sm_timer_t **value = (vivid_sm_timer_t **)vivid_map_set(me->timer_map, (size_t)name);
-        if (value == NULL) {
-            me->init_error = true;
-            return false;
-        }
-        if (*value != NULL) {
-            VIVID_LOG_ERROR(me->log, "%s | timer %s not unique", me->name, name);
+    if (me->current_event->id == VIVID_EVENT_ID_INIT) {
+        if (!register_event(me, event)) {
             me->init_error = true;
             return false;
         }
-        vivid_sm_timer_t *timer = (vivid_sm_timer_t *)me->binding->calloc(me->binding, 1U, sizeof(*timer));
-        if (timer == NULL) {
-            me->init_error = true;
+        vivid_sm_class_t *sm_class = me->sm_class;
+        if (me->init_sizing) {
+            sm_class->num_timers++;
             return false;
         }
-        *value = timer;
-        timer->vsm = me;
-        timer->name = name;
-        timer->binding_timer = me->binding->create_timer(me->binding, timer_callback, timer);
-        if (timer->binding_timer == NULL) {
+        if (me->next_timer == sm_class->num_timers) {
+            VIVID_LOG_ERROR(me->log, "%s | init | %s | more timers than when sizing", me->name, node->info->name);
             me->init_error = true;
             return false;
         }
+        // The binding timers are acquired by each instance when entering the node:
+        vivid_timer_info_t *timer_info = &sm_class->timers[me->next_timer++];
+        add_handler(node, event->id);
+        timer_info->next = sm_class->node_timers[get_index(node)];
+        sm_class->node_timers[get_index(node)] = timer_info;
+        timer_info->event = event;
         return false;
     }
-    if ((node->current_event->name != m_entry_string) && (node->current_event->name != m_exit_string) && (node->current_event->name != name)) {
+    vivid_event_id_t id = me->current_event->id;
+    if ((id != VIVID_EVENT_ID_ENTRY) && (id != VIVID_EVENT_ID_EXIT) && (id != event->id)) {
         return false;
     }
-    vivid_sm_timer_t *timer = (vivid_sm_timer_t *)vivid_map_get(me->timer_map, (size_t)name);
-    if (timer == NULL) {
-        VIVID_LOG_ERROR(me->log, "%s | could not find timer %s", me->name, name);
+    const vivid_timer_info_t *timer_info = me->sm_class->node_timers[get_index(node)];
+    while ((timer_info != NULL) && (timer_info->event != event)) {
+        timer_info = timer_info->next;
+    }
+    if (timer_info == NULL) {
+        VIVID_LOG_ERROR(me->log, "%s | could not find timer %s", me->name, event->name);
         return false;
     }
+    vivid_sm_timer_t *timer = &me->timers[timer_info - me->sm_class->timers];
     vivid_time_t current_time = me->binding->get_time(me->binding);
-    if (node->current_event->name == m_entry_string) {
+    if (id == VIVID_EVENT_ID_ENTRY) {
+        if (!acquire_timer(me, timer)) {
+            return false;
+        }
         timer->due_time = current_time + timeout;
-        me->binding->start_timer(timer->binding_timer, timeout);
+        me->binding->start_timer(timer->slot->binding_timer, timeout);
         timer->active = true;
         return false;
     }
-    if (node->current_event->name == m_exit_string) {
-        me->binding->stop_timer(timer->binding_timer);
+    if (id == VIVID_EVENT_ID_EXIT) {
+        if (timer->slot != NULL) {
+            me->binding->stop_timer(timer->slot->binding_timer);
+            release_timer(me, timer);
+        }
         timer->active = false;
         return false;
     }
@@ -519,99 +1560,357 @@ bool vivid_on_timeout(vivid_node_t *node, const char *name, vivid_time_t timeout
     return true;
 }
 
-bool vivid_jump(vivid_node_t *node VIVID_PARAM_ARGS(, const void **param, const char *param_event_name) VIVID_UML_ARGS(, vivid_state_t target_fn, const char *guard_text, const char *target_name, const char *action_text, const char *json_props))
+bool vivid_jump(vivid_node_t *node VIVID_PARAM_ARGS(, const void **param, vivid_event_t *param_event) VIVID_UML_ARGS(, vivid_state_t target_fn, const char *guard_text, const char *target_name, const char *action_text, const char *json_props))
 {
     vivid_uml_on_transition(node, VIVID_TRANSITION_TYPE_JUMP, "", "", guard_text, target_name, target_fn, action_text, json_props);
     vivid_sm_t *me = node->vsm;
-    if (node->current_event->name == m_entry_string) {
-        me->jump = true;
+    if (me->current_event->id == VIVID_EVENT_ID_INIT) {
+#if VIVID_PARAM
+        if ((param_event != NULL) && !register_event(me, param_event)) {
+            me->init_error = true;
+            return false;
+        }
+#endif
+        if (!me->init_sizing) {
+            add_handler(node, VIVID_EVENT_ID_JUMP);
+        }
         return false;
     }
-    if (node->current_event->name != m_jump_string) {
+    if (me->current_event->id != VIVID_EVENT_ID_JUMP) {
         return false;
     }
 #if VIVID_PARAM
     if (param != NULL) {
-        if (node->last_event == NULL) {
-            VIVID_LOG_ERROR(me->log, "%s | %s | no jump param available: %s", me->name, node->name, param_event_name);
+        if (me->last_event == NULL) {
+            VIVID_LOG_ERROR(me->log, "%s | %s | no jump param available: %s", me->name, node->info->name, param_event->name);
             return false;
         }
-        if (node->last_event->name != param_event_name) {
-            VIVID_LOG_ERROR(me->log, "%s | %s | incorrect jump param: %s vs %s", me->name, node->name, param_event_name, node->last_event->name);
+        if (me->last_event->id != param_event->id) {
+            VIVID_LOG_ERROR(me->log, "%s | %s | incorrect jump param: %s vs %s", me->name, node->info->name, param_event->name, me->last_event->name);
             return false;
         }
-        *param = node->last_event->param;
+        *param = me->last_event->param;
     }
 #endif
     return true;
 }
 
+static const vivid_transition_path_t *get_transition_path(vivid_node_t *node, vivid_state_t target_fn VIVID_LOG_ARGS(, const char *target_name))
+{
+    for (const vivid_transition_path_t *path = node->transitions; path != NULL; path = path->next) {
+        if (path->target_fn == target_fn) {
+            return path;
+        }
+    }
+    vivid_sm_t *me = node->vsm;
+    me->num_node_lookups++;
+    vivid_node_t *target_node = vivid_find_node(me, target_fn);
+    if (target_node == NULL) {
+        VIVID_LOG_ERROR(me->log, "%s | %s | node not found: %s", me->name, node->info->name, target_name);
+        return NULL;
+    }
+    vivid_node_t *ancestor = node;
+    while (ancestor->info->depth > target_node->info->depth) {
+        ancestor = vivid_get_node(me, ancestor->info->parent);
+    }
+    vivid_node_t *ancestor_dest = target_node;
+    while (ancestor_dest->info->depth > node->info->depth) {
+        ancestor_dest = vivid_get_node(me, ancestor_dest->info->parent);
+    }
+    while (ancestor != ancestor_dest) {
+        ancestor = vivid_get_node(me, ancestor->info->parent);
+        ancestor_dest = vivid_get_node(me, ancestor_dest->info->parent);
+    }
+    size_t num_exits = node->info->depth - ancestor->info->depth + 1U;
+    size_t num_entries = target_node->info->depth - ancestor->info->depth + 1U;
+    vivid_transition_path_t *path = (vivid_transition_path_t *)me->binding->calloc(me->binding, 1U, sizeof(*path) + ((num_exits + num_entries) * sizeof(path->path[0])));
+    if (path == NULL) {
+        VIVID_LOG_ERROR(me->log, "%s | %s | could not allocate transition: %s", me->name, node->info->name, target_name);
+        return NULL;
+    }
+    path->target_fn = target_fn;
+    path->ancestor = ancestor;
+    path->reenter_ancestor = (node == ancestor) || (target_node == ancestor);
+    path->num_exits = num_exits;
+    path->num_entries = num_entries;
+    vivid_node_t *exit_node = node;
+    for (size_t i = 0U; i < num_exits; i++) {
+        path->path[i] = exit_node;
+        exit_node = vivid_get_node(me, exit_node->info->parent);
+    }
+    vivid_node_t *entry_node = target_node;
+    for (size_t i = num_entries; i > 0U; i--) {
+        path->path[num_exits + i - 1U] = entry_node;
+        entry_node = vivid_get_node(me, entry_node->info->parent);
+    }
+    path->next = node->transitions;
+    node->transitions = path;
+    return path;
+}
+
 bool vivid_transit(vivid_node_t *node, bool guard, vivid_state_t target_fn VIVID_LOG_ARGS(, const char *type, const char *name, const char *guard_text, const char *target_name))
 {
     vivid_sm_t *me = node->vsm;
 #if VIVID_LOG
-    if (!guard || (strcmp(guard_text, m_true_string) != 0)) {
-        VIVID_LOG_DEBUG(me->log, "%s | %-5s | %s%s%s: \"%s\" is %s", me->name, type, name, (*name != '\0') ? ": " : "", node->name, guard_text, guard ? m_true_string : m_false_string);
-    } else if (node->type == VIVID_NODE_TYPE_CONDITION) {
-        VIVID_LOG_DEBUG(me->log, "%s | %-5s | %s%s%s: [else]", me->name, type, name, (*name != '\0') ? ": " : "", node->name);
+    if (vivid_log_enabled(me->log, VIVID_LOG_LEVEL_DEBUG)) {
+        if (!guard || (strcmp(guard_text, m_true_string) != 0)) {
+            VIVID_LOG_DEBUG(me->log, "%s | %-5s | %s%s%s: \"%s\" is %s", me->name, type, name, (*name != '\0') ? ": " : "", node->info->name, guard_text, guard ? m_true_string : m_false_string);
+        } else if (node->info->type == VIVID_NODE_TYPE_CONDITION) {
+            VIVID_LOG_DEBUG(me->log, "%s | %-5s | %s%s%s: [else]", me->name, type, name, (*name != '\0') ? ": " : "", node->info->name);
+        }
     }
 #endif
     if (!guard) {
         return false;
     }
-    VIVID_LOG_INFO(me->log, "%s | %-5s | %s%s%s%s%s", me->name, type, name, (*name != '\0') ? ": " : "", node->name, (target_fn != NULL) ? " -> " : "", (target_fn != NULL) ? target_name : "");
+    VIVID_LOG_INFO(me->log, "%s | %-5s | %s%s%s%s%s", me->name, type, name, (*name != '\0') ? ": " : "", node->info->name, (target_fn != NULL) ? " -> " : "", (target_fn != NULL) ? target_name : "");
     if (target_fn == NULL) {
         return true;
     }
-    vivid_node_t *target_node = vivid_map_get(me->node_map, (size_t)target_fn);
-    if (target_node == NULL) {
-        VIVID_LOG_ERROR(me->log, "%s | %s | node not found: %s", me->name, node->name, target_name);
+    const vivid_transition_path_t *path = get_transition_path(node, target_fn VIVID_LOG_ARGS(, target_name));
+    if (path == NULL) {
         return false;
     }
-    vivid_node_t *ancestor_src = node;
-    while (ancestor_src->depth > target_node->depth) {
-        ancestor_src = ancestor_src->parent;
-    }
-    vivid_node_t *ancestor_dest = target_node;
-    while (ancestor_dest->depth > node->depth) {
-        ancestor_dest = ancestor_dest->parent;
-    }
-    while (ancestor_src != ancestor_dest) {
-        ancestor_src = ancestor_src->parent;
-        ancestor_dest = ancestor_dest->parent;
-    }
-    bool reenter_ancestor = (node == ancestor_src) || (target_node == ancestor_src);
-    walk_exit_up(node, ancestor_src, NULL, reenter_ancestor);
-    me->transition.target = target_node;
-    me->transition.ancestor = ancestor_src;
-    me->transition.reenter_ancestor = reenter_ancestor;
+    exit_path(path);
+    me->transition.path = path;
     me->transition.state_change = false;
     return true;
 }
 
-void vivid_queue_event(vivid_sm_t *me, const char *name VIVID_PARAM_ARGS(, VIVID_PARAM_STATIC_ARGS(const) void *param, VIVID_PARAM_STATIC_ARGS(size_t param_size) VIVID_PARAM_DYNAMIC_ARGS(vivid_param_destructor_t param_destructor)))
+// Whether a report of an event lost or dropped would be seen, by the logger or by the error hook:
+static bool is_overload_reported(vivid_sm_t *me, bool lost)
+{
+#if VIVID_LOG
+    if (me->binding->log != NULL) {
+        return true;
+    }
+#endif
+    return lost && (me->binding->error_hook != NULL);
+}
+
+// Reports the events lost, or dropped for others, at most once per VIVID_OVERLOAD_REPORT_TIME, so
+// that reporting them does not slow down the state machine further. The clock is only read if the
+// report would be seen:
+static void report_overload(vivid_sm_t *me, const vivid_event_t *event, bool lost)
+{
+#if VIVID_LOCKFREE
+    (void)atomic_fetch_add(&me->num_dropped_events, 1U);
+    if (!is_overload_reported(me, lost)) {
+        return;
+    }
+    vivid_time_t time = me->binding->get_time(me->binding);
+    vivid_time_t next_report_time = atomic_load(&me->next_report_time);
+    if ((time < next_report_time) || !atomic_compare_exchange_strong(&me->next_report_time, &next_report_time, time + VIVID_CONVERT_TIME(VIVID_OVERLOAD_REPORT_TIME))) {
+        return;
+    }
+#else
+    bool reported = is_overload_reported(me, lost);
+    vivid_time_t time = reported ? me->binding->get_time(me->binding) : 0;
+    (void)me->binding->lock_mutex(me->binding_mutex);
+    me->num_dropped_events++;
+    bool report = reported && (time >= me->next_report_time);
+    if (report) {
+        me->next_report_time = time + VIVID_CONVERT_TIME(VIVID_OVERLOAD_REPORT_TIME);
+    }
+    me->binding->unlock_mutex(me->binding_mutex);
+    if (!report) {
+        return;
+    }
+#endif
+    vivid_log_error(me->binding, lost ? "queue event error - vsm name and event name to follow" : "queue event dropped an older one - vsm name and event name to follow");
+    vivid_log_error(me->binding, me->name);
+    vivid_log_error(me->binding, event->name);
+    if (lost && (me->binding->error_hook != NULL)) {
+        me->binding->error_hook(me->binding->app, VIVID_ERROR_QUEUE_EVENT);
+    }
+}
+
+// Sleeps for a step while blocked by a full queue, and returns false once the block timeout has been
+// slept, counted without reading the clock:
+static bool sleep_blocked(vivid_sm_t *me, vivid_time_t *remaining_time)
+{
+    if (*remaining_time <= 0) {
+        return false;
+    }
+    vivid_time_t sleep_time = VIVID_CONVERT_TIME(VIVID_OVERLOAD_SLEEP_TIME);
+    if (*remaining_time < sleep_time) {
+        sleep_time = *remaining_time;
+    }
+    me->binding->sleep(me->binding, sleep_time);
+    *remaining_time -= sleep_time;
+    return true;
+}
+
+typedef enum {
+    OVERLOAD_LOST,
+    OVERLOAD_QUEUED,
+    OVERLOAD_REPLACED
+} overload_result_t;
+
+// Applies the overload policy to an event whose queue is full:
+static overload_result_t queue_overloaded_event(vivid_sm_t *me, vivid_queue_t *queue, const vivid_event_t *event, vivid_time_t deadline VIVID_PARAM_ARGS(, VIVID_PARAM_STATIC_ARGS(const) void *param, VIVID_PARAM_STATIC_ARGS(size_t param_size) VIVID_PARAM_DYNAMIC_ARGS(vivid_param_destructor_t param_destructor)))
+{
+    switch (me->overload_policy) {
+    case VIVID_OVERLOAD_BLOCK: {
+        vivid_time_t remaining_time = me->block_timeout;
+        while (sleep_blocked(me, &remaining_time)) {
+            if (vivid_queue_try_push(queue, event->id, event->name, deadline VIVID_PARAM_ARGS(, param VIVID_PARAM_STATIC_ARGS(, param_size) VIVID_PARAM_DYNAMIC_ARGS(, param_destructor)))) {
+                return OVERLOAD_QUEUED;
+            }
+        }
+        break;
+    }
+#if !VIVID_LOCKFREE
+    case VIVID_OVERLOAD_DROP_OLDEST:
+    case VIVID_OVERLOAD_REPLACE_SAME: {
+        vivid_queue_replace_t replace = (me->overload_policy == VIVID_OVERLOAD_DROP_OLDEST) ? VIVID_QUEUE_REPLACE_OLDEST : VIVID_QUEUE_REPLACE_SAME_ID;
+        vivid_event_id_t dropped_id = vivid_queue_push_replacing(queue, replace, event->id, event->name, deadline VIVID_PARAM_ARGS(, param VIVID_PARAM_STATIC_ARGS(, param_size) VIVID_PARAM_DYNAMIC_ARGS(, param_destructor)));
+        if (dropped_id != VIVID_EVENT_ID_NONE) {
+            // A coalesced event dropped may be queued again:
+            if ((dropped_id != event->id) && is_in_event_set(me->sm_class, me->sm_class->coalesced_events, dropped_id)) {
+                clear_pending(me, dropped_id);
+            }
+            report_overload(me, event, false);
+            return OVERLOAD_REPLACED;
+        }
+        break;
+    }
+#endif
+    default:
+        break;
+    }
+    report_overload(me, event, true);
+    return OVERLOAD_LOST;
+}
+
+void vivid_queue_event(vivid_sm_t *me, const vivid_event_t *event VIVID_PARAM_ARGS(, VIVID_PARAM_STATIC_ARGS(const) void *param, VIVID_PARAM_STATIC_ARGS(size_t param_size) VIVID_PARAM_DYNAMIC_ARGS(vivid_param_destructor_t param_destructor)))
+{
+    vivid_time_t deadline = 0;
+    if (event->ttl > 0) {
+        deadline = me->binding->get_time(me->binding) + event->ttl;
+    }
+    vivid_queue_event_with_deadline(me, event, deadline VIVID_PARAM_ARGS(, param VIVID_PARAM_STATIC_ARGS(, param_size) VIVID_PARAM_DYNAMIC_ARGS(, param_destructor)));
+}
+
+void vivid_queue_event_with_deadline(vivid_sm_t *me, const vivid_event_t *event, vivid_time_t deadline VIVID_PARAM_ARGS(, VIVID_PARAM_STATIC_ARGS(const) void *param, VIVID_PARAM_STATIC_ARGS(size_t param_size) VIVID_PARAM_DYNAMIC_ARGS(vivid_param_destructor_t param_destructor)))
 {
-    if (!vivid_queue_push(me->event_queue, name VIVID_PARAM_ARGS(, param VIVID_PARAM_STATIC_ARGS(, param_size) VIVID_PARAM_DYNAMIC_ARGS(, param_destructor)))) {
-        vivid_log_error(me->binding, "queue event error - vsm name and event name to follow");
-        vivid_log_error(me->binding, me->name);
-        vivid_log_error(me->binding, name);
-        if (me->binding->error_hook != NULL) {
-            me->binding->error_hook(me->binding->app, VIVID_ERROR_QUEUE_EVENT);
+    bool coalesced = event->coalesce && is_in_event_set(me->sm_class, me->sm_class->coalesced_events, event->id);
+    if (coalesced && !set_pending(me, event->id)) {
+        return; // Already queued
+    }
+    size_t lane = (event->lane < me->num_lanes) ? event->lane : (me->num_lanes - 1U);
+    vivid_queue_t *queue = me->event_queues[lane];
+    overload_result_t result = OVERLOAD_QUEUED;
+    if (!vivid_queue_try_push(queue, event->id, event->name, deadline VIVID_PARAM_ARGS(, param VIVID_PARAM_STATIC_ARGS(, param_size) VIVID_PARAM_DYNAMIC_ARGS(, param_destructor)))) {
+        result = queue_overloaded_event(me, queue, event, deadline VIVID_PARAM_ARGS(, param VIVID_PARAM_STATIC_ARGS(, param_size) VIVID_PARAM_DYNAMIC_ARGS(, param_destructor)));
+    }
+    if (result == OVERLOAD_LOST) {
+        if (coalesced) {
+            clear_pending(me, event->id);
         }
         return;
     }
+    if ((result == OVERLOAD_QUEUED) && (me->watermark_callback != NULL)) {
+        count_queued(me, true);
+    }
+    me->binding->trigger_event(me->binding_event);
+}
+
+#if VIVID_PARAM
+void *vivid_reserve_event(vivid_sm_t *me, const vivid_event_t *event, size_t param_size, vivid_event_reservation_t *reservation)
+{
+#if VIVID_PARAM_DYNAMIC
+    (void)event;
+    reservation->param = me->binding->calloc(me->binding, 1U, param_size);
+    return reservation->param;
+#else
+    bool coalesced = event->coalesce && is_in_event_set(me->sm_class, me->sm_class->coalesced_events, event->id);
+    if (coalesced && !set_pending(me, event->id)) {
+        return NULL; // Already queued
+    }
+    size_t lane = (event->lane < me->num_lanes) ? event->lane : (me->num_lanes - 1U);
+    reservation->queue = me->event_queues[lane];
+    void *param = vivid_queue_reserve(reservation->queue, param_size, &reservation->queue_reservation);
+    // No entry already queued can be dropped or replaced for the reserved one, as its param is not
+    // filled yet, so only blocking applies:
+    if ((param == NULL) && (me->overload_policy == VIVID_OVERLOAD_BLOCK)) {
+        vivid_time_t remaining_time = me->block_timeout;
+        while ((param == NULL) && sleep_blocked(me, &remaining_time)) {
+            param = vivid_queue_reserve(reservation->queue, param_size, &reservation->queue_reservation);
+        }
+    }
+    if (param == NULL) {
+        report_overload(me, event, true);
+        if (coalesced) {
+            clear_pending(me, event->id);
+        }
+    }
+    return param;
+#endif
+}
+
+void vivid_commit_event(vivid_sm_t *me, const vivid_event_t *event, vivid_event_reservation_t *reservation)
+{
+#if VIVID_PARAM_DYNAMIC
+    vivid_queue_event(me, event, reservation->param, me->binding->free);
+#else
+    vivid_time_t deadline = 0;
+    if (event->ttl > 0) {
+        deadline = me->binding->get_time(me->binding) + event->ttl;
+    }
+    vivid_queue_commit(reservation->queue, &reservation->queue_reservation, event->id, event->name, deadline);
+    if (me->watermark_callback != NULL) {
+        count_queued(me, true);
+    }
     me->binding->trigger_event(me->binding_event);
+#endif
+}
+#endif
+
+void vivid_dispatch_event(vivid_sm_t *me, const vivid_event_t *event VIVID_PARAM_ARGS(, VIVID_PARAM_STATIC_ARGS(const) void *param, VIVID_PARAM_STATIC_ARGS(size_t param_size) VIVID_PARAM_DYNAMIC_ARGS(vivid_param_destructor_t param_destructor)))
+{
+    if (me->dispatching) {
+        // The local queue is only needed once the state machine dispatches an event to itself, and
+        // is only pushed by this thread:
+        if (me->local_queue == NULL) {
+            me->local_queue = create_queue(me, VIVID_QUEUE_SINGLE_PRODUCER);
+        }
+        if ((me->local_queue == NULL) || !vivid_queue_try_push(me->local_queue, event->id, event->name, 0 VIVID_PARAM_ARGS(, param VIVID_PARAM_STATIC_ARGS(, param_size) VIVID_PARAM_DYNAMIC_ARGS(, param_destructor)))) {
+            report_overload(me, event, true);
+        }
+        return;
+    }
+    if (me->init) {
+        start(me);
+    }
+    vivid_queue_entry_t entry = { 0 };
+    entry.name = event->name;
+    entry.id = event->id;
+#if VIVID_PARAM
+    entry.param = (void *)param;
+#if VIVID_PARAM_DYNAMIC
+    entry.param_destructor = param_destructor;
+#else
+    entry.param_size = param_size;
+#endif
+#endif
+    dispatch(me, &entry);
+#if VIVID_PARAM_DYNAMIC
+    if (param_destructor != NULL) {
+        param_destructor(param);
+    }
+#endif
 }
 
 bool vivid_is_in(vivid_sm_t *me, vivid_state_t state)
 {
-    vivid_node_t *node = (vivid_node_t *)vivid_map_get(me->node_map, (size_t)state);
-    return (node != NULL) && ((node->parent == NULL) || (get_state(node->parent) == node));
+    vivid_node_t *node = vivid_find_node(me, state);
+    return (node != NULL) && ((node->info->parent == VIVID_NODE_INDEX_NONE) || (get_state(&me->nodes[node->info->parent]) == node));
 }
 
 vivid_state_t vivid_get_state(vivid_sm_t *me, vivid_state_t parent_state VIVID_LOG_ARGS(, const char **name))
 {
-    vivid_node_t *parent_node = (vivid_node_t *)vivid_map_get(me->node_map, (size_t)parent_state);
+    vivid_node_t *parent_node = vivid_find_node(me, parent_state);
     if (parent_node == NULL) {
         goto undefined_state;
     }
@@ -621,10 +1920,10 @@ vivid_state_t vivid_get_state(vivid_sm_t *me, vivid_state_t parent_state VIVID_L
     }
 #if VIVID_LOG
     if (name != NULL) {
-        *name = node->name;
+        *name = node->info->name;
     }
 #endif
-    return node->fn;
+    return node->info->fn;
 undefined_state:
 #if VIVID_LOG
     if (name != NULL) {
@@ -633,3 +1932,18 @@ undefined_state:
 #endif
     return NULL;
 }
+
+size_t vivid_get_active_states(vivid_sm_t *me, vivid_state_t *states, size_t max_states VIVID_LOG_ARGS(, const char **names))
+{
+    size_t num_states = me->num_active_nodes;
+    for (size_t i = 0U; (i < num_states) && (i < max_states); i++) {
+        const vivid_node_t *node = &me->nodes[me->active_nodes[i]];
+        states[i] = node->info->fn;
+#if VIVID_LOG
+        if (names != NULL) {
+            names[i] = node->info->name;
+        }
+#endif
+    }
+    return num_states;
+}
@@ -27,8 +27,8 @@ struct vivid_uml {
     int indent;
 };
 
-static const char *const m_uml_string = "uml";
-static const char *const m_uml_default_string = "uml_default";
+static const vivid_event_t m_uml_event = { .name = "uml", .id = VIVID_EVENT_ID_UML };
+static const vivid_event_t m_uml_default_event = { .name = "uml_default", .id = VIVID_EVENT_ID_UML_DEFAULT };
 static const char *const m_true_string = "true";
 static const char *const m_dir_string = "dir";
 static const char *const m_note_string = "note";
@@ -153,52 +153,53 @@ static void add_code(FILE *fp, const char *code, bool add_newlines)
 
 void vivid_uml_on_entry_or_exit(vivid_node_t *node, const char *dir, const char *action_text)
 {
-    if ((node->current_event->name != m_uml_string) || !is_action(action_text)) {
+    if ((node->vsm->current_event->id != VIVID_EVENT_ID_UML) || !is_action(action_text)) {
         return;
     }
-    FILE *fp = node->vsm->uml->fp;
-    fprintf(fp, "%*s%s : %s/", node->vsm->uml->indent * INDENT_WIDTH, "", node->name, dir);
-    add_code(fp, action_text, false);
-    fputc('\n', fp);
+    vivid_uml_t *me = node->vsm->sm_class->uml;
+    fprintf(me->fp, "%*s%s : %s/", me->indent * INDENT_WIDTH, "", node->info->name, dir);
+    add_code(me->fp, action_text, false);
+    fputc('\n', me->fp);
 }
 
 static void add_stereotype(vivid_node_t *node)
 {
     const char *stereotype;
-    if (node->type == VIVID_NODE_TYPE_CONDITION) {
+    if (node->info->type == VIVID_NODE_TYPE_CONDITION) {
         stereotype = "choice";
-    } else if ((node->type == VIVID_NODE_TYPE_JUNCTION) || (node->type == VIVID_NODE_TYPE_STATE_FINAL)) {
+    } else if ((node->info->type == VIVID_NODE_TYPE_JUNCTION) || (node->info->type == VIVID_NODE_TYPE_STATE_FINAL)) {
         stereotype = "end";
     } else {
         return;
     }
-    fprintf(node->vsm->uml->fp, "%*sstate %s <<%s>>\n", node->vsm->uml->indent * INDENT_WIDTH, "", node->name, stereotype);
+    vivid_uml_t *me = node->vsm->sm_class->uml;
+    fprintf(me->fp, "%*sstate %s <<%s>>\n", me->indent * INDENT_WIDTH, "", node->info->name, stereotype);
 }
 
 void vivid_uml_on_transition(vivid_node_t *node, vivid_transition_type_t type, const char *name, const char *timeout_text, const char *guard_text, const char *target_name, vivid_state_t target_fn, const char *action_text, const char *json_props)
 {
     if ((type == VIVID_TRANSITION_TYPE_DEFAULT)
-            ? (node->current_event->name != m_uml_default_string)
-            : (node->current_event->name != m_uml_string)) {
+            ? (node->vsm->current_event->id != VIVID_EVENT_ID_UML_DEFAULT)
+            : (node->vsm->current_event->id != VIVID_EVENT_ID_UML)) {
         return;
     }
-    vivid_uml_t *me = node->vsm->uml;
+    vivid_uml_t *me = node->vsm->sm_class->uml;
     FILE *fp = me->fp;
     vivid_node_t *target_node = NULL;
     if (target_fn != NULL) {
-        target_node = (vivid_node_t *)vivid_map_get(node->vsm->node_map, (size_t)target_fn);
+        target_node = vivid_find_node(node->vsm, target_fn);
     }
     add_stereotype(node);
     if (target_node == NULL) {
-        fprintf(fp, "%*s%s", me->indent * INDENT_WIDTH, "", node->name);
+        fprintf(fp, "%*s%s", me->indent * INDENT_WIDTH, "", node->info->name);
     } else {
         add_stereotype(target_node);
         int dir_len;
         const char *dir = get_json_prop(me, json_props, m_dir_string, &dir_len);
-        fprintf(fp, "%*s%s -%.*s-> %s", me->indent * INDENT_WIDTH, "", (type == VIVID_TRANSITION_TYPE_DEFAULT) ? "[*]" : node->name, dir_len, dir, target_node->name);
+        fprintf(fp, "%*s%s -%.*s-> %s", me->indent * INDENT_WIDTH, "", (type == VIVID_TRANSITION_TYPE_DEFAULT) ? "[*]" : node->info->name, dir_len, dir, target_node->info->name);
     }
     bool is_guard_true = strcmp(guard_text, m_true_string) == 0;
-    bool is_condition = node->type == VIVID_NODE_TYPE_CONDITION;
+    bool is_condition = node->info->type == VIVID_NODE_TYPE_CONDITION;
     switch (type) {
     case VIVID_TRANSITION_TYPE_DEFAULT:
     case VIVID_TRANSITION_TYPE_JUMP:
@@ -242,31 +243,34 @@ void vivid_uml_on_transition(vivid_node_t *node, vivid_transition_type_t type, c
 
 static void walk_uml(vivid_node_t *node, int indent)
 {
-    vivid_uml_t *me = node->vsm->uml;
+    vivid_sm_t *vsm = node->vsm;
+    const vivid_node_info_t *info = node->info;
+    const vivid_node_info_t *nodes = vsm->sm_class->nodes;
+    vivid_uml_t *me = vsm->sm_class->uml;
     FILE *fp = me->fp;
     int note_len;
-    const char *note = get_json_prop(me, node->json_props, m_note_string, &note_len);
+    const char *note = get_json_prop(me, info->json_props, m_note_string, &note_len);
     if (note != NULL) {
         int pos_len;
-        const char *pos = get_json_prop(me, node->json_props, m_pos_string, &pos_len);
+        const char *pos = get_json_prop(me, info->json_props, m_pos_string, &pos_len);
         if (pos != NULL) {
-            fprintf(fp, "note %.*s of %s\n%.*s\nend note\n", pos_len, pos, node->name, note_len, note);
+            fprintf(fp, "note %.*s of %s\n%.*s\nend note\n", pos_len, pos, info->name, note_len, note);
         } else {
-            fprintf(fp, "note as note_%s\n%.*s\nend note\n", node->name, note_len, note);
+            fprintf(fp, "note as note_%s\n%.*s\nend note\n", info->name, note_len, note);
         }
     }
     me->indent = indent;
-    vivid_call_node(node, m_uml_string);
-    if (node->siblings != NULL) {
-        walk_uml(node->siblings, indent);
+    vivid_call_node(node, &m_uml_event);
+    if (info->siblings != VIVID_NODE_INDEX_NONE) {
+        walk_uml(&vsm->nodes[info->siblings], indent);
     }
-    if (node->children != NULL) {
-        bool is_root = node->parent == NULL;
-        bool parallel_siblings = !is_root && node->parent->parallel_children;
+    if (info->children != VIVID_NODE_INDEX_NONE) {
+        bool is_root = info->parent == VIVID_NODE_INDEX_NONE;
+        bool parallel_siblings = !is_root && nodes[info->parent].parallel_children;
         if (parallel_siblings) {
-            if (node->siblings != NULL) {
+            if (info->siblings != VIVID_NODE_INDEX_NONE) {
                 int sep_len;
-                const char *sep = get_json_prop(me, node->parent->json_props, m_sep_string, &sep_len);
+                const char *sep = get_json_prop(me, nodes[info->parent].json_props, m_sep_string, &sep_len);
                 if (sep == NULL) {
                     sep = "||";
                     sep_len = 2;
@@ -274,12 +278,12 @@ static void walk_uml(vivid_node_t *node, int indent)
                 fprintf(fp, "%*s%*s\n", indent * INDENT_WIDTH, "", sep_len, sep);
             }
         } else if (!is_root) {
-            fprintf(fp, "%*sstate %s {\n", indent * INDENT_WIDTH, "", node->name);
+            fprintf(fp, "%*sstate %s {\n", indent * INDENT_WIDTH, "", info->name);
         }
         int child_indent = indent + ((parallel_siblings || is_root) ? 0U : 1U);
         me->indent = child_indent;
-        vivid_call_node(node, m_uml_default_string);
-        walk_uml(node->children, child_indent);
+        vivid_call_node(node, &m_uml_default_event);
+        walk_uml(&vsm->nodes[info->children], child_indent);
         if (!parallel_siblings && !is_root) {
             fprintf(fp, "%*s}\n", indent * INDENT_WIDTH, "");
         }
@@ -293,10 +297,10 @@ void vivid_save_uml(vivid_sm_t *me, const char *filename)
         VIVID_LOG_ERROR(me->log, "%s | could not open %s for writing", me->name, filename);
         return;
     }
-    me->uml->fp = fp;
+    me->sm_class->uml->fp = fp;
     VIVID_LOG_INFO(me->log, "%s | writing to %s...", me->name, filename);
     fputs("@startuml\n", fp);
-    walk_uml(me->root_node, 0U);
+    walk_uml(&me->nodes[0], 0U);
     fputs("@enduml\n", fp);
     fclose(fp);
 }
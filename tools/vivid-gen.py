@@ -1,6 +1,7 @@
 # Copyright Amazon.com, Inc. or its affiliates. All Rights Reserved.
 # SPDX-License-Identifier: Apache-2.0.
 
+import io
 import json
 import os
 import sys
@@ -15,13 +16,15 @@ if __name__ == '__main__':
 class VividSmParser():
     INDENT_WIDTH = 2
 
-    def __init__(self, filename, output_directory):
+    def __init__(self, filename, output_directory, tables=False, dispatch=False):
         if not any(filename.lower().endswith(ext) for ext in ['.c', '.cpp', '.cc', '.cxx']):
             return
         self.parse_file(filename)
         if not self.states:
             return
         self.write_puml(filename, output_directory)
+        if tables or dispatch:
+            self.write_tables(filename, output_directory, dispatch)
 
     def get_arg(self):
         start_index = self.index
@@ -93,9 +96,53 @@ class VividSmParser():
             self.index += 1
         return out.strip()
 
+    def skip_blanks(self, skip_semicolons):
+        while self.index < len(self.code):
+            if self.code.startswith('//', self.index):
+                end = self.code.find('\n', self.index)
+                self.index = len(self.code) if end < 0 else end + 1
+            elif self.code.startswith('/*', self.index):
+                end = self.code.find('*/', self.index + 2)
+                self.index = len(self.code) if end < 0 else end + 2
+            elif self.code[self.index].isspace() or (skip_semicolons and self.code[self.index] == ';'):
+                self.index += 1
+            else:
+                break
+
+    def has_only_macros(self):
+        # Whether the body of the state function after the index only calls VIVID_ macros, as the
+        # dispatcher runs none of the rest of the state function
+        start_index = self.index
+        try:
+            self.index += 1 # the closing paren of VIVID_STATE()
+            self.skip_blanks(False)
+            if self.code[self.index] != '{':
+                return True # Not a definition
+            self.index += 1
+            while True:
+                self.skip_blanks(True)
+                if self.code[self.index] == '}':
+                    return True
+                macro_start = self.index
+                while self.code[self.index] in "ABCDEFGHIJKLMNOPQRSTUVWXYZ_":
+                    self.index += 1
+                if not self.code.startswith('VIVID_', macro_start):
+                    return False
+                self.skip_blanks(False)
+                if self.code[self.index] != '(':
+                    return False
+                self.index += 1
+                while self.code[self.index] != ')':
+                    self.get_arg()
+                self.index += 1
+        except IndexError:
+            return False
+        finally:
+            self.index = start_index
+
     def add_state(self, state):
         if state not in self.states:
-            self.states[state] = {'children': [], 'transitions': [], 'parallel_children': False, 'json_props': {}, 'type': 'ROOT'}
+            self.states[state] = {'children': [], 'transitions': [], 'parallel_children': False, 'json_props': {}, 'json_text': '', 'type': 'ROOT'}
 
     def get_json(self, json_string):
         try:
@@ -136,12 +183,16 @@ class VividSmParser():
                         module = self.get_arg()
                         current_state = self.get_arg()
                         self.add_state(current_state)
+                        self.states[current_state]['fn'] = f'{module}::state_{current_state}' if macro == 'VIVID_STATE_CPP' else f'state_{current_state}'
+                        self.states[current_state]['app_type'] = None if macro == 'VIVID_STATE_CPP' else module
+                        self.states[current_state]['only_macros'] = self.has_only_macros()
                     elif macro in sub_states:
                         sub_state = self.get_arg()
                         self.add_state(sub_state)
                         self.states[current_state]['children'].append(sub_state)
                         self.states[sub_state]['type'] = macro[len("VIVID_SUB_"):]
-                        self.states[sub_state]['json_props'] = self.get_json(self.get_arg())
+                        self.states[sub_state]['json_text'] = self.get_arg()
+                        self.states[sub_state]['json_props'] = self.get_json(self.states[sub_state]['json_text'])
                         self.states[sub_state]['parent'] = current_state
                         if macro == 'VIVID_SUB_STATE_PARALLEL':
                             self.states[sub_state]['parallel_children'] = True
@@ -150,7 +201,7 @@ class VividSmParser():
                     elif macro == "VIVID_ON_EXIT":
                         self.states[current_state]['exit_action'] = self.get_arg()
                     elif macro in transitions:
-                        transition = {'guard': 'true'}
+                        transition = {'guard': 'true', 'macro': macro}
                         if macro != 'VIVID_DEFAULT':
                             if macro != 'VIVID_JUMP':
                                 transition['trigger'] = self.get_arg()
@@ -159,10 +210,12 @@ class VividSmParser():
                             transition['guard'] = self.get_arg()
                         transition['target'] = self.get_arg()
                         transition['action'] = self.get_arg()
-                        transition['json_props'] = self.get_json(self.get_arg())
+                        transition['json_text'] = self.get_arg()
+                        transition['json_props'] = self.get_json(transition['json_text'])
                         transition['type'] = macro[len("VIVID_"):].replace('_PARAM', '')
+                        transition['param'] = macro.endswith('_PARAM')
                         self.states[current_state]['transitions'].append(transition)
-                    elif macro == 'VIVID_CREATE_SM':
+                    elif macro in ['VIVID_CREATE_SM', 'VIVID_CREATE_SM_WITH_LANES', 'VIVID_CREATE_SM_CLASS', 'VIVID_CREATE_SM_FROM_TABLES', 'VIVID_CREATE_SM_CLASS_FROM_TABLES']:
                         binding = self.get_arg()
                         name = self.get_arg()
                         if name.find('"') >= 0: # if c string
@@ -301,7 +354,7 @@ class VividSmParser():
         for sm in self.sm:
             path = Path(input_filename)
             if len(self.sm) > 1:
-                path = path.with_name(f"{path.stem}_{sm.name}.puml")
+                path = path.with_name(f"{path.stem}_{sm['name']}.puml")
             else:
                 path = path.with_suffix('.puml')
             output_filename = os.path.join(output_directory, path.name)
@@ -311,6 +364,132 @@ class VividSmParser():
                 self.walk_puml(sm['root_state'], 0)
                 self.fp.write('@enduml\n')
 
+    def get_c_string(self, text):
+        return '"' + text.replace('\\', '\\\\').replace('"', '\\"') + '"'
+
+    def index_states(self, state_name, depth, parent, nodes):
+        # Same order and links as recorded by vivid_create_sm_class(), the last sub-state first
+        if state_name not in self.states or 'fn' not in self.states[state_name]:
+            raise Exception(f'State {state_name} not defined')
+        index = len(nodes)
+        node = {'name': state_name, 'depth': depth, 'parent': parent, 'children': None, 'siblings': None}
+        nodes.append(node)
+        for child in self.states[state_name]['children']:
+            child_index = self.index_states(child, depth + 1, index, nodes)
+            nodes[child_index]['siblings'] = node['children']
+            node['children'] = child_index
+        node['subtree_end'] = len(nodes)
+        return index
+
+    def write_dispatch(self, prefix, nodes, events):
+        self.fp.write(f'// Handlers of each event in each state, see vivid_dispatch_t:\n')
+        self.fp.write(f'static void {prefix}_dispatch(vivid_node_t *node, void *app, size_t node_index, size_t event_index)\n{{\n')
+        self.fp.write(f'    switch ((node_index * {len(events)}U) + event_index) {{\n')
+        for index, node in enumerate(nodes):
+            state = self.states[node['name']]
+            if state['app_type'] is None:
+                raise Exception(f"State {node['name']} not defined with VIVID_STATE(), as needed by the dispatcher")
+            if not state['only_macros']:
+                raise Exception(f"State {node['name']} has code other than VIVID_ macros, which the dispatcher would not run")
+            for event in node['events']:
+                self.fp.write(f"    case ({index}U * {len(events)}U) + {events.index(event)}U: {{ // {node['name']}, {event}\n")
+                self.fp.write(f"        {state['app_type']} *me = ({state['app_type']} *)app;\n")
+                self.fp.write('        (void)me;\n')
+                for transition in state['transitions']:
+                    if transition['type'] == 'ON_EVENT' and transition['trigger'] == event:
+                        args = [transition['trigger'], transition['guard'], transition['target'], transition['action']]
+                        if transition['json_text']:
+                            args.append(transition['json_text'])
+                        self.fp.write(f"        {transition['macro']}({', '.join(args)});\n")
+                self.fp.write('        break;\n    }\n')
+        self.fp.write('    default:\n        break;\n    }\n}\n\n')
+
+    def write_sm_tables(self, root_state, dispatch):
+        nodes = []
+        self.index_states(root_state, 0, None, nodes)
+        indices = {node['name']: index for index, node in enumerate(nodes)}
+        get_index = lambda index: 'VIVID_NODE_INDEX_NONE' if index is None else f'{index}U'
+        events = []
+        param_events = []
+        for node in nodes:
+            state = self.states[node['name']]
+            node['events'] = []
+            node['default_child'] = None
+            for transition in state['transitions']:
+                if transition['type'] == 'DEFAULT':
+                    if transition['target'] not in indices:
+                        raise Exception(f"Default sub-state {transition['target']} of {node['name']} not defined")
+                    node['default_child'] = indices[transition['target']]
+                if transition['type'] == 'ON_EVENT' and transition['trigger'] not in node['events']:
+                    node['events'].append(transition['trigger'])
+                if transition['type'] in ['ON_EVENT', 'JUMP'] and transition['param'] and transition['trigger'] not in param_events:
+                    param_events.append(transition['trigger'])
+                if 'trigger' in transition and transition['type'] != 'ON_TIMEOUT' and transition['trigger'] not in events:
+                    events.append(transition['trigger'])
+            if state['children'] and not any(self.states[child]['type'] == 'STATE_PARALLEL' for child in state['children']) and node['default_child'] is None:
+                raise Exception(f"Undefined default sub-state of {node['name']}")
+        prefix = f'm_{root_state}'
+        self.fp.write(f'// Tables of the state machine rooted at {root_state}, see vivid_create_sm_class_from_tables():\n')
+        self.fp.write(f'static const vivid_node_info_t {prefix}_nodes[] = {{\n')
+        self.fp.write('    // fn, parent, children, siblings, default_child, depth, subtree_end, type, parallel_children, name, json_props\n')
+        for node in nodes:
+            state = self.states[node['name']]
+            parallel_children = any(self.states[child]['type'] == 'STATE_PARALLEL' for child in state['children'])
+            self.fp.write(f"    {{ {state['fn']}, {get_index(node['parent'])}, {get_index(node['children'])}, {get_index(node['siblings'])}, "
+                          f"{get_index(node['default_child'])}, {node['depth']}U, {node['subtree_end']}U, VIVID_NODE_TYPE_{state['type']}, "
+                          f"{'true' if parallel_children else 'false'} VIVID_LOG_ARGS(, \"{node['name']}\" VIVID_UML_ARGS(, {self.get_c_string(state['json_text'])})) }},\n")
+        self.fp.write('};\n\n')
+        self.fp.write(f'static vivid_event_t *const {prefix}_no_events[] = {{ NULL }};\n')
+        for node in nodes:
+            if node['events']:
+                self.fp.write(f"static vivid_event_t *const {prefix}_{node['name']}_events[] = {{ {''.join(f'&m_{event}_event, ' for event in node['events'])}NULL }};\n")
+        self.fp.write(f'\nstatic const vivid_node_handlers_t {prefix}_handlers[] = {{\n')
+        self.fp.write('    // events, jumps, timers\n')
+        for node in nodes:
+            transitions = self.states[node['name']]['transitions']
+            node_events = f"{prefix}_{node['name']}_events" if node['events'] else f'{prefix}_no_events'
+            jumps = 'true' if any(transition['type'] == 'JUMP' for transition in transitions) else 'false'
+            timers = 'true' if any(transition['type'] == 'ON_TIMEOUT' for transition in transitions) else 'false'
+            self.fp.write(f'    {{ {node_events}, {jumps}, {timers} }},\n')
+        self.fp.write('};\n\n')
+        self.fp.write(f"static vivid_event_t *const {prefix}_events[] = {{ {''.join(f'&m_{event}_event, ' for event in events)}NULL }};\n\n")
+        if param_events:
+            # The size of a union is at least that of its largest member
+            self.fp.write('#if VIVID_PARAM_STATIC\n')
+            self.fp.write(f'typedef union {{\n')
+            for event in param_events:
+                self.fp.write(f'    {event}_param_type_t {event};\n')
+            self.fp.write(f'}} {prefix}_params_t;\n')
+            self.fp.write('#endif\n\n')
+        if dispatch:
+            self.write_dispatch(prefix, nodes, events)
+        max_param_size = f'sizeof({prefix}_params_t)' if param_events else '0U'
+        dispatch_fn = f'{prefix}_dispatch' if dispatch else 'NULL'
+        self.fp.write(f'static const vivid_sm_tables_t {prefix}_tables = {{ {prefix}_nodes, {prefix}_handlers, {len(nodes)}U, {prefix}_events, {dispatch_fn} VIVID_PARAM_STATIC_ARGS(, {max_param_size}) }};\n')
+
+    def write_tables(self, input_filename, output_directory, dispatch):
+        path = Path(input_filename)
+        output_filename = os.path.join(output_directory, f'{path.stem}_tables.h')
+        guard = ''.join(char if char.isalnum() else '_' for char in f'{path.stem}_tables_h').upper()
+        # Generate the whole header first, so that no partial header is left on errors
+        self.fp = io.StringIO()
+        self.fp.write(f'// Generated by vivid-gen.py from {path.name}, do not edit.\n')
+        if dispatch:
+            self.fp.write(f'// Include after the state functions of {path.name}.\n\n')
+        else:
+            self.fp.write(f'// Include after the events and the state declarations of {path.name}.\n\n')
+        self.fp.write(f'#ifndef {guard}\n#define {guard}\n')
+        root_states = []
+        for sm in self.sm:
+            if sm['root_state'] not in root_states:
+                root_states.append(sm['root_state'])
+                self.fp.write('\n')
+                self.write_sm_tables(sm['root_state'], dispatch)
+        self.fp.write('\n#endif\n')
+        print(f"writing to {output_filename}")
+        with open(output_filename, 'w') as fp:
+            fp.write(self.fp.getvalue())
+
 
 if __name__ == '__main__':
     class Handler(FileSystemEventHandler):
@@ -321,7 +500,7 @@ if __name__ == '__main__':
                 return
             if event.event_type == 'created' or event.event_type == 'modified':
                 try:
-                    VividSmParser(event.src_path, args.output)
+                    VividSmParser(event.src_path, args.output, args.tables, args.dispatch)
                 except:
                     pass
 
@@ -331,18 +510,20 @@ if __name__ == '__main__':
     parser.add_argument('-i', '--input', default='.', help='Input file or directory. Default: current working directory.')
     parser.add_argument('-m', '--monitor', action='store_true', help='File monitoring is performed.')
     parser.add_argument('-o', '--output', default='out', help='Output directory. Default: out')
+    parser.add_argument('-t', '--tables', action='store_true', help='A C header with the tables of each state machine is also generated, see vivid_create_sm_class_from_tables().')
+    parser.add_argument('-d', '--dispatch', action='store_true', help='Same as --tables, with a dispatcher handling the events without calling the state functions, see vivid_dispatch_t.')
     args = parser.parse_args()    
     
     if not os.path.exists(args.output):
         os.mkdir(args.output)
     output_map = {}
     if os.path.isfile(args.input):
-        VividSmParser(args.input, args.output)
+        VividSmParser(args.input, args.output, args.tables, args.dispatch)
     else:
         for root, subdirs, files in os.walk(args.input):
             for filename in files:
                 file_path = os.path.join(root, filename)
-                VividSmParser(file_path, args.output)
+                VividSmParser(file_path, args.output, args.tables, args.dispatch)
     if args.monitor:
         print(f"monitoring '{args.input}' for changes")
         observer = Observer()